@@ -12,14 +12,9 @@ if [ ! -d "$WD/glfw" ]; then
     )
 fi
 
-flags=(
-    "-ferror-limit=1"
-    -ffast-math
-    -fno-autolink
-    -fno-exceptions
-    -fno-math-errno
-    -fno-rtti
-    -fno-unwind-tables
+. "$WD/scripts/flags.sh"
+
+sanitizers=(
     "-fsanitize=address"
     "-fsanitize=bounds"
     "-fsanitize=float-divide-by-zero"
@@ -27,29 +22,10 @@ flags=(
     "-fsanitize=integer"
     "-fsanitize=nullability"
     "-fsanitize=undefined"
-    -fshort-enums
-    -g
-    "-march=native"
-    "-std=c++11"
-    -Werror
-    -Weverything
-    -Wno-c++98-compat-pedantic
-    -Wno-c99-extensions
-    -Wno-disabled-macro-expansion
-    -Wno-extra-semi-stmt
-    -Wno-padded
-    -Wno-reserved-id-macro
-)
-libs=(
-    -ldl
-    -lGL
-    -lX11
-    -lXfixes
-    -pthread
-)
-paths=(
-    "-I$WD/glfw/include"
 )
+if [ "${TRACE:-0}" = 1 ]; then
+    flags+=("-DTRACING")
+fi
 
 now () {
     date +%s.%N
@@ -57,13 +33,33 @@ now () {
 
 (
     start=$(now)
-    mold -run clang++ -O1 "${flags[@]}" -o "$WD/bin/codegen" \
-        "$WD/src/codegen.cpp"
-    "$WD/bin/codegen" > "$WD/src/scene_assets_codegen.hpp"
+    mold -run clang++ -O1 "${flags[@]}" "${sanitizers[@]}" -pthread \
+        -o "$WD/bin/codegen" "$WD/src/codegen.cpp"
+    "$WD/bin/codegen" "$WD/bin/platforms.level"
+    mold -run clang++ -O1 "${flags[@]}" "${sanitizers[@]}" \
+        -o "$WD/bin/monitor" "$WD/src/monitor.cpp"
     "$WD/scripts/codegen.py" > "$WD/src/init_assets_codegen.hpp"
     clang-format -i -verbose "$WD/src"/*
     mold -run clang++ -O3 "${paths[@]}" "${libs[@]}" "${flags[@]}" \
-        -o "$WD/bin/main" "$WD/glfw/src/libglfw3.a" "$WD/src/main.cpp"
+        "${sanitizers[@]}" -o "$WD/bin/main" "$WD/glfw/src/libglfw3.a" \
+        "$WD/src/main.cpp"
+    # NOTE: Tests and benchmarks check the code as shipped, so no
+    # sanitizers. The test never touches GL, so it builds against the
+    # headless headers and walks the stream over a generated level;
+    # `bin/platforms.level` is too small for the walk to leave a chunk behind.
+    mold -run clang++ -O3 "${flags[@]}" -pthread -o "$WD/bin/generate" \
+        "$WD/src/generate.cpp"
+    "$WD/bin/generate" mixed-size 100000 1 "$WD/bin/stream.level"
+    mold -run clang++ -O3 "${flags[@]}" -DHEADLESS -pthread \
+        -o "$WD/bin/test" "$WD/src/test.cpp"
+    "$WD/bin/test" --level "$WD/bin/platforms.level" \
+        --stream "$WD/bin/stream.level"
+    mold -run clang++ -O3 "${flags[@]}" -pthread -o "$WD/bin/bench" \
+        "$WD/src/bench.cpp"
+    mold -run clang++ -O3 "${flags[@]}" -pthread -o "$WD/bin/server" \
+        "$WD/src/server.cpp"
+    mold -run clang++ -O3 "${flags[@]}" -DHEADLESS -ldl -lEGL -lGL -pthread \
+        -o "$WD/bin/headless" "$WD/src/headless.cpp"
     end=$(now)
     python3 -c "print(\"Compiled! ({:.3f}s)\n\".format($end - $start))"
 )
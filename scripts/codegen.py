@@ -5,23 +5,101 @@ from os.path import join
 
 WD = environ["WD"]
 
+# NOTE: Feature flags the scene shaders are specialized on; bit `i` of a
+# variant's mask is `FEATURES[i]`. `#ifdef`/`#ifndef` blocks on these are
+# resolved here rather than by the driver, so each variant carries only its
+# own code.
+#   - `SCALED` assumes instance matrices only translate and scale, which
+#     trades `inverse()` for a divide.
+#   - `UNLIT` drops lighting, and with it normals.
+FEATURES = ["SCALED", "UNLIT"]
 
-def codegen(var, path):
+
+def read(path):
     with open(path, "r") as file:
-        return "static const char {}[] = {{ {}, 0, }};".format(
-            var,
-            ", ".join(map(str, map(ord, file.read())))
-        )
+        return file.read()
+
+
+def codegen(var, source):
+    return "static const char {}[] = {{ {}, 0, }};".format(
+        var,
+        ", ".join(map(str, map(ord, source)))
+    )
+
+
+def specialize(source, mask):
+    lines = []
+    stack = []
+    for line in source.splitlines():
+        words = line.split()
+        if words and (words[0] in ["#ifdef", "#ifndef"]) and \
+                (words[1] in FEATURES):
+            enabled = bool(mask & (1 << FEATURES.index(words[1])))
+            stack.append(enabled == (words[0] == "#ifdef"))
+            continue
+        if stack and words == ["#else"]:
+            stack[-1] = not stack[-1]
+            continue
+        if stack and words == ["#endif"]:
+            stack.pop()
+            continue
+        if all(stack):
+            lines.append(line)
+    assert not stack
+    return "\n".join(lines) + "\n"
+
+
+def get_name(prefix, mask):
+    return "_".join([prefix] + [
+        feature for (i, feature) in enumerate(FEATURES) if mask & (1 << i)
+    ])
+
+
+# NOTE: Variants that specialize to the same text share one array, named
+# after the first mask that produced it.
+def codegen_variants(prefix, source, lines):
+    names = []
+    sources = {}
+    for mask in range(1 << len(FEATURES)):
+        variant = specialize(source, mask)
+        if variant not in sources:
+            sources[variant] = get_name(prefix, mask)
+            lines.append(codegen(sources[variant], variant))
+        names.append(sources[variant])
+    return names
 
 
 def main():
-    print("\n".join([
+    lines = [
         "#ifndef __INIT_ASSETS_CODEGEN_H__",
         "#define __INIT_ASSETS_CODEGEN_H__",
-        codegen("SHADER_VERT", join(WD, "src", "vert.glsl")),
-        codegen("SHADER_FRAG", join(WD, "src", "frag.glsl")),
-        "#endif",
+        "#include \"prelude.hpp\"",
+    ]
+    for (i, feature) in enumerate(FEATURES):
+        lines.append("#define SHADER_{} {}".format(feature, 1 << i))
+    lines.append("#define SHADER_LEN_VARIANTS {}".format(1 << len(FEATURES)))
+    lines.append("\n".join([
+        "struct ShaderVariant {",
+        "    const char* vert;",
+        "    const char* frag;",
+        "};",
     ]))
+    vert = read(join(WD, "src", "vert.glsl"))
+    frag = read(join(WD, "src", "frag.glsl"))
+    verts = codegen_variants("SHADER_VERT", vert, lines)
+    frags = codegen_variants("SHADER_FRAG", frag, lines)
+    lines.append(
+        "static const ShaderVariant SHADER_VARIANTS[SHADER_LEN_VARIANTS] = {")
+    for mask in range(1 << len(FEATURES)):
+        lines.append("    {{ {}, {}, }},".format(verts[mask], frags[mask]))
+    lines.append("};")
+    lines.extend([
+        codegen("SHADER_HIZ_VERT", read(join(WD, "src", "hiz_vert.glsl"))),
+        codegen("SHADER_HIZ_FRAG", read(join(WD, "src", "hiz_frag.glsl"))),
+        codegen("SHADER_CULL_VERT", read(join(WD, "src", "cull_vert.glsl"))),
+        "#endif",
+    ])
+    print("\n".join(lines))
 
 
 if __name__ == "__main__":
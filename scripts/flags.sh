@@ -0,0 +1,36 @@
+# NOTE: Sourced by `scripts/build.sh` and `scripts/release.sh`, so both builds
+# compile with the same warnings and codegen flags and only differ in what
+# they add on top: sanitizers for the former, `-O3`, LTO and PGO for the
+# latter.
+
+flags=(
+    "-ferror-limit=1"
+    -ffast-math
+    -fno-autolink
+    -fno-exceptions
+    -fno-math-errno
+    -fno-rtti
+    -fno-unwind-tables
+    -fshort-enums
+    -g
+    "-march=native"
+    "-std=c++11"
+    -Werror
+    -Weverything
+    -Wno-c++98-compat-pedantic
+    -Wno-c99-extensions
+    -Wno-disabled-macro-expansion
+    -Wno-extra-semi-stmt
+    -Wno-padded
+    -Wno-reserved-id-macro
+)
+libs=(
+    -ldl
+    -lGL
+    -lX11
+    -lXfixes
+    -pthread
+)
+paths=(
+    "-I$WD/glfw/include"
+)
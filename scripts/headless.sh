@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+
+set -eu
+
+# NOTE: `scripts/headless.sh [args...]`; renders `bin/headless`'s camera path
+# off-screen and fails if the last frame doesn't match `GOLDEN`. The default
+# is what Mesa's `llvmpipe` draws of the generated level over the default 600
+# frames; other drivers rasterize a little differently, so take a fresh one
+# from a run you trust when switching.
+
+"$WD/scripts/build.sh"
+
+cd "$WD"
+
+EGL_PLATFORM=surfaceless "$WD/bin/headless" \
+    --golden "${GOLDEN:-bdb199bac225c713}" "$@"
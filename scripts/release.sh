@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+
+set -eu
+
+# NOTE: Optimized build without sanitizers or GL error checks: `-O3`, thin
+# LTO, and PGO trained on `--train`. `scripts/build.sh` still produces the
+# sanitized `bin/main`, which is also what the speedup is measured against.
+
+"$WD/scripts/build.sh"
+
+. "$WD/scripts/flags.sh"
+
+flags+=(
+    -O3
+    "-flto=thin"
+    -DRELEASE
+)
+
+frames=2000
+
+(
+    mold -run clang++ "${paths[@]}" "${libs[@]}" "${flags[@]}" \
+        -fprofile-instr-generate -o "$WD/bin/main_train" \
+        "$WD/glfw/src/libglfw3.a" "$WD/src/main.cpp"
+    rm -f "$WD/bin/main"*.profraw
+    LLVM_PROFILE_FILE="$WD/bin/main.profraw" \
+        "$WD/bin/main_train" --train "$frames" > /dev/null
+    llvm-profdata merge -output="$WD/bin/main.profdata" \
+        "$WD/bin/main.profraw"
+    mold -run clang++ "${paths[@]}" "${libs[@]}" "${flags[@]}" \
+        -Wno-profile-instr-missing -Wno-profile-instr-unprofiled \
+        -fprofile-instr-use="$WD/bin/main.profdata" \
+        -o "$WD/bin/main_release" \
+        "$WD/glfw/src/libglfw3.a" "$WD/src/main.cpp"
+)
+
+export ASAN_OPTIONS="detect_leaks=0"
+
+debug=$("$WD/bin/main" --train "$frames" | grep "^train")
+release=$("$WD/bin/main_release" --train "$frames" | grep "^train")
+echo "debug   $debug"
+echo "release $release"
+python3 - "$debug" "$release" <<PYTHON
+import sys
+debug, release = (
+    [float(x) for x in line.split()[1::2]] for line in sys.argv[1:]
+)
+print("speedup {:.2f}x steps/s, {:.2f}x frame time".format(
+    release[3] / debug[3],
+    debug[1] / release[1],
+))
+PYTHON
@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+
+set -eu
+
+# NOTE: `scripts/server.sh [seconds]`; runs `bin/server` against 1, 10, 100,
+# and 1000 scripted clients over loopback, reporting server tick time and
+# bandwidth per client at each, and fails if any client decoded a world that
+# differs from the server's. The clients share the machine with the server,
+# so on few cores their cost shows up in the server's tick times too.
+
+"$WD/scripts/build.sh"
+
+seconds="${1:-5}"
+
+for players in 1 10 100 1000; do
+    "$WD/bin/server" --clients "$players" --seconds "$seconds"
+done
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+
+set -eu
+
+# NOTE: `scripts/startup.sh [args...]`; time to first frame with an empty
+# program cache and then with the one the first run left behind. The driver's
+# own shader cache isn't touched, so "cold" still benefits from it.
+
+export ASAN_OPTIONS="detect_leaks=0"
+
+"$WD/scripts/build.sh"
+
+cd "$WD"
+rm -rf "$WD/bin/cache"
+
+for run in cold warm; do
+    printf "%-5s " "$run"
+    "$WD/bin/main" --train 1 "$@" | grep "^startup"
+done
@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+
+set -eu
+
+# NOTE: `scripts/stress.sh [seed]`; benchmarks every generated layout at every
+# size, leaving one `bench` report per level in `bin/stress/`.
+
+"$WD/scripts/build.sh"
+
+seed="${1:-1}"
+mkdir -p "$WD/bin/stress"
+
+for layout in uniform clustered towers sparse-huge mixed-size; do
+    for count in 1000 10000 100000 1000000 10000000; do
+        level="$WD/bin/stress/$layout.$count.level"
+        "$WD/bin/generate" "$layout" "$count" "$seed" "$level"
+        "$WD/bin/bench" --level "$level" \
+            --json "$WD/bin/stress/$layout.$count.json"
+        rm "$level"
+    done
+done
@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+
+set -eu
+
+TRACE=1 "$WD/scripts/build.sh"
+
+export ASAN_OPTIONS="detect_leaks=0"
+
+# NOTE: Dumps `trace-<frame>.json` on `SIGUSR1` or whenever a frame runs long;
+# open them in `chrome://tracing` or `ui.perfetto.dev`.
+"$WD/bin/main" --trace "$WD/trace" "$@" || echo $?
@@ -0,0 +1,150 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include "math.hpp"
+
+#include <sys/mman.h>
+
+// NOTE: Bump allocators over address space reserved once at startup. Only
+// touched pages are ever committed, so capacities can be generous; nothing is
+// freed individually, only by resetting a whole arena.
+//   - `permanent` lives as long as the process.
+//   - `level` is reset whenever a level is loaded.
+//   - `frame` is scratch for work that is done within one step: linking
+//     programs at startup, encoding one server tick's snapshots, one
+//     benchmark iteration. Whoever uses it resets it first. The render loop
+//     allocates nothing per frame, so it doesn't reset it.
+#define ARENA_PAGE      (1lu << 12)
+#define ARENA_HUGE_PAGE (1lu << 21)
+
+#define ARENA_CAP_PERMANENT (1lu << 26)
+#define ARENA_CAP_LEVEL     (1lu << 28)
+#define ARENA_CAP_FRAME     (1lu << 24)
+
+// NOTE: `--huge-pages transparent` asks for `THP` with `madvise`, which the
+// kernel is free to ignore. `--huge-pages explicit` maps from the `hugetlbfs`
+// pool and falls back to `transparent` when the pool can't reserve the whole
+// arena up front; reserving lazily would turn an empty pool into `SIGBUS`.
+#define ARENA_PAGES_NORMAL      0
+#define ARENA_PAGES_TRANSPARENT 1
+#define ARENA_PAGES_EXPLICIT    2
+
+struct Arena {
+    u8*         region;
+    u8*         base;
+    const char* name;
+    usize       size_region;
+    usize       cap;
+    usize       len;
+    usize       high_water;
+    u8          pages;
+};
+
+struct Arenas {
+    Arena permanent;
+    Arena level;
+    Arena frame;
+};
+
+static Arenas ARENAS;
+
+static u8* arena_align(u8* pointer, usize align) {
+    return reinterpret_cast<u8*>(
+        (reinterpret_cast<usize>(pointer) + (align - 1)) & ~(align - 1));
+}
+
+// NOTE: The arena starts on a huge page boundary and is fenced by at least
+// one `PROT_NONE` page on either side, so running off either end faults
+// instead of scribbling over a neighbour.
+static void arena_open(Arena* arena, const char* name, usize cap, u8 pages) {
+    EXIT_IF(cap % ARENA_HUGE_PAGE);
+    arena->size_region = ARENA_HUGE_PAGE + cap + ARENA_PAGE;
+    void* region = mmap(null,
+                        arena->size_region,
+                        PROT_NONE,
+                        MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE,
+                        -1,
+                        0);
+    EXIT_IF(region == MAP_FAILED);
+    arena->region = static_cast<u8*>(region);
+    arena->base = arena_align(arena->region + ARENA_PAGE, ARENA_HUGE_PAGE);
+    arena->name = name;
+    arena->cap = cap;
+    arena->len = 0;
+    arena->high_water = 0;
+    arena->pages = pages;
+    const i32 flags =
+        MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE | MAP_FIXED;
+    if ((pages == ARENA_PAGES_EXPLICIT) &&
+        (mmap(arena->base,
+              cap,
+              PROT_READ | PROT_WRITE,
+              (flags & ~MAP_NORESERVE) | MAP_HUGETLB,
+              -1,
+              0) == MAP_FAILED))
+    {
+        fprintf(stderr, "arena %s : no explicit huge pages\n", name);
+        arena->pages = ARENA_PAGES_TRANSPARENT;
+    }
+    if (arena->pages == ARENA_PAGES_EXPLICIT) {
+        return;
+    }
+    EXIT_IF(mmap(arena->base, cap, PROT_READ | PROT_WRITE, flags, -1, 0) ==
+            MAP_FAILED);
+    if ((arena->pages == ARENA_PAGES_TRANSPARENT) &&
+        madvise(arena->base, cap, MADV_HUGEPAGE))
+    {
+        fprintf(stderr, "arena %s : no transparent huge pages\n", name);
+        arena->pages = ARENA_PAGES_NORMAL;
+    }
+}
+
+static void arena_close(Arena* arena) {
+    EXIT_IF(munmap(arena->region, arena->size_region));
+    arena->region = null;
+    arena->base = null;
+}
+
+// NOTE: Memory is zeroed only the first time it is handed out; anything
+// allocated after a reset holds whatever the previous user left behind.
+static void* arena_alloc(Arena* arena, usize size, usize align) {
+    const usize offset = (arena->len + (align - 1)) & ~(align - 1);
+    EXIT_IF((arena->cap < offset) || ((arena->cap - offset) < size));
+    arena->len = offset + size;
+    arena->high_water = MAX(arena->high_water, arena->len);
+    return arena->base + offset;
+}
+
+template <typename T>
+static T* arena_alloc(Arena* arena, usize count) {
+    return static_cast<T*>(arena_alloc(arena, sizeof(T) * count, alignof(T)));
+}
+
+static void arena_reset(Arena* arena) {
+    arena->len = 0;
+}
+
+static void arena_set(u8 pages) {
+    arena_open(&ARENAS.permanent, "permanent", ARENA_CAP_PERMANENT, pages);
+    arena_open(&ARENAS.level, "level", ARENA_CAP_LEVEL, pages);
+    arena_open(&ARENAS.frame, "frame", ARENA_CAP_FRAME, pages);
+}
+
+static void arena_print(const Arena* arena) {
+    printf("arena %-10s : %10zu / %10zu bytes (high water), pages %hhu\n",
+           arena->name,
+           arena->high_water,
+           arena->cap,
+           arena->pages);
+}
+
+static void arena_delete() {
+    arena_print(&ARENAS.permanent);
+    arena_print(&ARENAS.level);
+    arena_print(&ARENAS.frame);
+    arena_close(&ARENAS.frame);
+    arena_close(&ARENAS.level);
+    arena_close(&ARENAS.permanent);
+}
+
+#endif
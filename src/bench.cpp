@@ -0,0 +1,575 @@
+#include "level.hpp"
+#include "pacing.hpp"
+#include "player.hpp"
+#include "sweep.hpp"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE: Each benchmark first runs for at least `BENCH_WARMUP`, doubling its
+// iteration count until one sample takes at least `BENCH_SAMPLE`, then
+// records `BENCH_SAMPLES` samples of that many iterations each.
+#define BENCH_WARMUP  (NANOSECONDS / 10lu)
+#define BENCH_SAMPLE  (NANOSECONDS / 1000lu)
+#define BENCH_SAMPLES 51
+
+#define BENCH_CAP_RESULTS 32
+
+#define BENCH_SIZES    3
+#define BENCH_QUERIES  (1lu << 10)
+#define BENCH_INPUTS   (1lu << 12)
+#define BENCH_MATRICES (1lu << 3)
+#define BENCH_POINTS   (1lu << 10)
+#define BENCH_PATHS    (1lu << 8)
+
+// NOTE: Agents wander a box `BENCH_AGENT_SPACING` units on a side per agent
+// in `x` and `z`, and a jump high, at up to `SPEED_MAX`, bouncing off its
+// walls; at this spacing most have about one neighbour at a time.
+#define BENCH_AGENT_SIZES   4
+#define BENCH_AGENT_SPACING 3.0f
+#define BENCH_AGENT_PAIRS   8
+
+// NOTE: Cells of the `grid_pairs` baseline are as wide as an agent, so two
+// agents that touch are filed in the same or neighbouring cells.
+#define BENCH_AGENT_CELL MAX(PLAYER_WIDTH, PLAYER_DEPTH)
+
+// NOTE: Keeps the compiler from discarding a result nothing else reads.
+#define BENCH_ESCAPE(x) __asm__ volatile("" : : "g"(&(x)) : "memory")
+
+typedef void (*BenchFunc)(u64 iterations);
+
+struct BenchResult {
+    const char* name;
+    u64         iterations;
+    f64         median;
+    f64         low;
+    f64         high;
+    f64         min;
+};
+
+// NOTE: `pairs` is rebuilt from scratch every tick by the baseline, over
+// `len_columns` by `len_columns` cells.
+struct BenchAgents {
+    Cube*      cubes;
+    Vec3*      speeds;
+    SweepPair* pairs;
+    Cube       bounds;
+    Sweep      sweep;
+    u32        len;
+    u32        len_pairs;
+    u32        len_columns;
+};
+
+// NOTE: `build` is the arena `hash_set` rebuilds the level's grid into,
+// sized from the level; at stress sizes one rebuild outgrows `ARENAS.frame`.
+struct Bench {
+    GridMemory  grid;
+    GridMemory  grid_built;
+    Arena       build;
+    Reach       reach;
+    ReachQuery  paths[BENCH_PATHS];
+    Cube        queries[BENCH_SIZES][BENCH_QUERIES];
+    Input       inputs[BENCH_INPUTS];
+    Mat4        matrices[BENCH_MATRICES];
+    Vec4        points[BENCH_POINTS];
+    Vec4        transformed[BENCH_POINTS];
+    BenchAgents agents[BENCH_AGENT_SIZES];
+    Player      player;
+    u64         tick;
+    u32         seed;
+    f64         samples[BENCH_SAMPLES];
+    BenchResult results[BENCH_CAP_RESULTS];
+    u8          len_results;
+};
+
+static Bench BENCH;
+
+// NOTE: Half-extents of the `hash_set_intersects` queries: the player, a
+// handful of platforms, and most of the level.
+static const Vec3 BENCH_QUERY_SIZE[BENCH_SIZES] = {
+    {PLAYER_WIDTH_HALF, PLAYER_HEIGHT / 2.0f, PLAYER_DEPTH_HALF},
+    {5.0f, 5.0f, 5.0f},
+    {25.0f, 25.0f, 25.0f},
+};
+
+static const u32 BENCH_AGENTS[BENCH_AGENT_SIZES] = {
+    100,
+    1000,
+    10000,
+    100000,
+};
+
+static u32 bench_get_random() {
+    BENCH.seed ^= BENCH.seed << 13;
+    BENCH.seed ^= BENCH.seed >> 17;
+    BENCH.seed ^= BENCH.seed << 5;
+    return BENCH.seed;
+}
+
+static f32 bench_get_random_f32(f32 l, f32 r) {
+    return l + ((r - l) * (static_cast<f32>(bench_get_random() >> 8) /
+                           static_cast<f32>(1 << 24)));
+}
+
+static Vec3 bench_get_random_vec3(Cube bounds) {
+    return {
+        bench_get_random_f32(bounds.bottom_left_front.x,
+                             bounds.top_right_back.x),
+        bench_get_random_f32(bounds.bottom_left_front.y,
+                             bounds.top_right_back.y),
+        bench_get_random_f32(bounds.bottom_left_front.z,
+                             bounds.top_right_back.z),
+    };
+}
+
+static void bench_set_agents(BenchAgents* agents, u32 len) {
+    const f32  side = sqrtf(static_cast<f32>(len)) * BENCH_AGENT_SPACING;
+    const Cube start = {{0.0f, 0.0f, 0.0f}, {side, JUMP_HEIGHT, side}};
+    const Vec3 size = {PLAYER_WIDTH, PLAYER_HEIGHT, PLAYER_DEPTH};
+    agents->len = len;
+    agents->bounds = {start.bottom_left_front, start.top_right_back + size};
+    agents->len_columns =
+        static_cast<u32>(agents->bounds.top_right_back.x / BENCH_AGENT_CELL) +
+        1;
+    agents->cubes = arena_alloc<Cube>(&ARENAS.level, len);
+    agents->speeds = arena_alloc<Vec3>(&ARENAS.level, len);
+    agents->pairs =
+        arena_alloc<SweepPair>(&ARENAS.level, len * BENCH_AGENT_PAIRS);
+    for (u32 i = 0; i < len; ++i) {
+        const Vec3 bottom_left_front = bench_get_random_vec3(start);
+        agents->cubes[i] = {bottom_left_front, bottom_left_front + size};
+        const f32 radians = bench_get_random_f32(0.0f, 2.0f * PI);
+        const f32 speed = bench_get_random_f32(0.0f, SPEED_MAX);
+        agents->speeds[i] = {
+            cosf(radians) * speed,
+            bench_get_random_f32(-JUMP, JUMP),
+            sinf(radians) * speed,
+        };
+    }
+    sweep_set(&agents->sweep,
+              &ARENAS.level,
+              agents->cubes,
+              len,
+              len * BENCH_AGENT_PAIRS);
+}
+
+static void bench_move_agents(BenchAgents* agents) {
+    const Vec3 bounds = agents->bounds.top_right_back;
+    for (u32 i = 0; i < agents->len; ++i) {
+        Cube* cube = &agents->cubes[i];
+        Vec3* speed = &agents->speeds[i];
+        cube->bottom_left_front += *speed;
+        cube->top_right_back += *speed;
+        if ((cube->bottom_left_front.x < 0.0f) ||
+            (bounds.x < cube->top_right_back.x))
+        {
+            speed->x = -speed->x;
+        }
+        if ((cube->bottom_left_front.y < 0.0f) ||
+            (bounds.y < cube->top_right_back.y))
+        {
+            speed->y = -speed->y;
+        }
+        if ((cube->bottom_left_front.z < 0.0f) ||
+            (bounds.z < cube->top_right_back.z))
+        {
+            speed->z = -speed->z;
+        }
+    }
+}
+
+static void bench_add_pair(BenchAgents* agents, u32 a, u32 b) {
+    const Cube* cubes = agents->cubes;
+    if (!sweep_overlaps_xz(&cubes[a], &cubes[b]) ||
+        !sweep_overlaps_y(&cubes[a], &cubes[b]))
+    {
+        return;
+    }
+    EXIT_IF(agents->len_pairs == (agents->len * BENCH_AGENT_PAIRS));
+    agents->pairs[agents->len_pairs++] = {MIN(a, b), MAX(a, b)};
+}
+
+static u32 bench_get_column(const BenchAgents* agents, f32 x) {
+    const f32 column = floorf(x / BENCH_AGENT_CELL);
+    if (column < 0.0f) {
+        return 0;
+    }
+    return MIN(static_cast<u32>(column), agents->len_columns - 1);
+}
+
+// NOTE: What `sweep_update` replaces, done the way most engines would: a
+// uniform grid over `x` and `z` with agent-sized cells, rebuilt from
+// scratch every tick. Each agent is filed once, by its minimum corner, into
+// a counting-sorted cell list, so every agent it touches sits in its own
+// cell or one of the eight around it. Each cell is paired with itself and
+// the four neighbours that come after it, which visits every pair once.
+static void bench_set_grid_pairs(BenchAgents* agents, Arena* arena) {
+    const u32 len_columns = agents->len_columns;
+    const u32 len_cells = len_columns * len_columns;
+    u32*      cells = arena_alloc<u32>(arena, agents->len);
+    u32*      offsets = arena_alloc<u32>(arena, len_cells + 1);
+    u32*      indices = arena_alloc<u32>(arena, agents->len);
+    memset(offsets, 0, sizeof(u32) * (len_cells + 1));
+    for (u32 i = 0; i < agents->len; ++i) {
+        const Vec3 corner = agents->cubes[i].bottom_left_front;
+        cells[i] = (bench_get_column(agents, corner.x) * len_columns) +
+                   bench_get_column(agents, corner.z);
+        ++offsets[cells[i]];
+    }
+    for (u32 i = 1; i < len_cells; ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    for (u32 i = agents->len; 0 < i; --i) {
+        indices[--offsets[cells[i - 1]]] = i - 1;
+    }
+    offsets[len_cells] = agents->len;
+    agents->len_pairs = 0;
+    for (u32 x = 0; x < len_columns; ++x) {
+        for (u32 z = 0; z < len_columns; ++z) {
+            const u32 cell = (x * len_columns) + z;
+            const u32 neighbours[4] = {
+                (z + 1) < len_columns ? cell + 1 : len_cells,
+                ((x + 1) < len_columns) && (0 < z)
+                    ? cell + len_columns - 1
+                    : len_cells,
+                (x + 1) < len_columns ? cell + len_columns : len_cells,
+                ((x + 1) < len_columns) && ((z + 1) < len_columns)
+                    ? cell + len_columns + 1
+                    : len_cells,
+            };
+            for (u32 j = offsets[cell]; j < offsets[cell + 1]; ++j) {
+                const u32 a = indices[j];
+                for (u32 k = j + 1; k < offsets[cell + 1]; ++k) {
+                    bench_add_pair(agents, a, indices[k]);
+                }
+                for (u8 n = 0; n < 4; ++n) {
+                    const u32 neighbour = neighbours[n];
+                    for (u32 k = offsets[neighbour];
+                         k < offsets[neighbour + 1];
+                         ++k)
+                    {
+                        bench_add_pair(agents, a, indices[k]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void bench_set(const char* path) {
+    BENCH.seed = 0x9E3779B9;
+    arena_set(ARENA_PAGES_NORMAL);
+    level_open(path, false);
+    level_set_grid(&BENCH.grid, &ARENAS.level);
+    {
+        const usize size =
+            hash_get_size(LEVEL.len_platforms, BENCH.grid.len_indices);
+        arena_open(&BENCH.build,
+                   "build",
+                   (size + (ARENA_HUGE_PAGE - 1)) & ~(ARENA_HUGE_PAGE - 1),
+                   ARENA_PAGES_NORMAL);
+    }
+    for (u8 i = 0; i < BENCH_SIZES; ++i) {
+        for (u64 j = 0; j < BENCH_QUERIES; ++j) {
+            const Vec3 center = bench_get_random_vec3(BENCH.grid.bounds);
+            BENCH.queries[i][j] = {
+                center - BENCH_QUERY_SIZE[i],
+                center + BENCH_QUERY_SIZE[i],
+            };
+        }
+    }
+    for (u64 i = 0; i < BENCH_INPUTS; ++i) {
+        BENCH.inputs[i] = get_scripted_input(i);
+    }
+    for (u64 i = 0; i < BENCH_MATRICES; ++i) {
+        for (u8 j = 0; j < 4; ++j) {
+            for (u8 k = 0; k < 4; ++k) {
+                BENCH.matrices[i].cell[j][k] =
+                    bench_get_random_f32(-1.0f, 1.0f);
+            }
+        }
+    }
+    for (u64 i = 0; i < BENCH_POINTS; ++i) {
+        BENCH.points[i].simd =
+            simd_get(bench_get_random_vec3(BENCH.grid.bounds), 1.0f);
+    }
+    set_player(&BENCH.player);
+    // NOTE: Only levels that carry a reach graph get path queries; building
+    // one here would take far longer than the benchmarks at stress sizes.
+    if (LEVEL.reach.offsets) {
+        level_set_reach(&BENCH.reach, &BENCH.grid, &ARENAS.level);
+        for (u64 i = 0; i < BENCH_PATHS; ++i) {
+            BENCH.paths[i] = {bench_get_random() % LEVEL.len_platforms,
+                              bench_get_random() % LEVEL.len_platforms};
+        }
+    }
+    for (u8 i = 0; i < BENCH_AGENT_SIZES; ++i) {
+        bench_set_agents(&BENCH.agents[i], BENCH_AGENTS[i]);
+    }
+}
+
+// NOTE: What startup pays for a level without a prebuilt grid.
+static void bench_hash_build(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        arena_reset(&BENCH.build);
+        hash_set(&BENCH.grid_built,
+                 &BENCH.build,
+                 LEVEL.platforms,
+                 LEVEL.len_platforms);
+        BENCH_ESCAPE(BENCH.grid_built);
+    }
+}
+
+template <u8 S>
+static void bench_hash_query(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        hash_set_intersects(&BENCH.grid,
+                            &BENCH.queries[S][i & (BENCH_QUERIES - 1)]);
+        BENCH_ESCAPE(BENCH.grid.len_intersects);
+    }
+}
+
+static void bench_set_motion(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        set_speed(&BENCH.inputs[BENCH.tick++ & (BENCH_INPUTS - 1)],
+                  &BENCH.player);
+        set_motion(&BENCH.grid, &BENCH.player);
+        BENCH_ESCAPE(BENCH.player);
+    }
+}
+
+// NOTE: One query per iteration, between random platforms, some of which
+// have no path.
+static void bench_reach_find_paths(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        arena_reset(&ARENAS.frame);
+        ReachPath path;
+        reach_find_paths(&BENCH.reach,
+                         LEVEL.platforms,
+                         &BENCH.paths[i & (BENCH_PATHS - 1)],
+                         &path,
+                         1,
+                         &ARENAS.frame);
+        BENCH_ESCAPE(path);
+    }
+}
+
+// NOTE: One tick per iteration, moving the agents included.
+template <u8 S>
+static void bench_sweep_update(u64 iterations) {
+    BenchAgents* agents = &BENCH.agents[S];
+    for (u64 i = 0; i < iterations; ++i) {
+        bench_move_agents(agents);
+        sweep_update(&agents->sweep);
+        BENCH_ESCAPE(agents->sweep.len_overlaps);
+    }
+}
+
+template <u8 S>
+static void bench_grid_pairs(u64 iterations) {
+    BenchAgents* agents = &BENCH.agents[S];
+    for (u64 i = 0; i < iterations; ++i) {
+        arena_reset(&ARENAS.frame);
+        bench_move_agents(agents);
+        bench_set_grid_pairs(agents, &ARENAS.frame);
+        BENCH_ESCAPE(agents->len_pairs);
+    }
+}
+
+static void bench_mat4_multiply(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        Mat4 matrix = BENCH.matrices[i & (BENCH_MATRICES - 1)] *
+                      BENCH.matrices[(i + 1) & (BENCH_MATRICES - 1)];
+        BENCH_ESCAPE(matrix);
+    }
+}
+
+static void bench_linear_combine(u64 iterations) {
+    Simd4f32 column = BENCH.matrices[0].column[0];
+    for (u64 i = 0; i < iterations; ++i) {
+        column =
+            linear_combine(column, BENCH.matrices[i & (BENCH_MATRICES - 1)]);
+        BENCH_ESCAPE(column);
+    }
+}
+
+static void bench_look_at(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        const Cube* query = &BENCH.queries[0][i & (BENCH_QUERIES - 1)];
+        Mat4        matrix = look_at(
+            query->bottom_left_front,
+            query->bottom_left_front +
+                BENCH.inputs[i & (BENCH_INPUTS - 1)].view_target,
+            VIEW_UP);
+        BENCH_ESCAPE(matrix);
+    }
+}
+
+static void bench_perspective(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        Mat4 matrix = perspective(get_radians(45.0f),
+                                  1.0f + (static_cast<f32>(i & 0xFF) / 256.0f),
+                                  0.1f,
+                                  1000.0f);
+        BENCH_ESCAPE(matrix);
+    }
+}
+
+// NOTE: Everything `set_uniforms` computes on the CPU each frame.
+static void bench_camera(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        const Cube* query = &BENCH.queries[0][i & (BENCH_QUERIES - 1)];
+        const f32   aspect_ratio =
+            1.0f + (static_cast<f32>(i & 0xFF) / 256.0f);
+        Mat4        projection =
+            perspective(get_radians(45.0f), aspect_ratio, 0.1f, 1000.0f);
+        Mat4        view = look_at(
+            query->bottom_left_front,
+            query->bottom_left_front +
+                BENCH.inputs[i & (BENCH_INPUTS - 1)].view_target,
+            VIEW_UP);
+        BENCH_ESCAPE(projection);
+        BENCH_ESCAPE(view);
+    }
+}
+
+static void bench_affine_inverse(u64 iterations) {
+    for (u64 i = 0; i < iterations; ++i) {
+        Mat4 matrix =
+            affine_inverse(LEVEL.instances[i % LEVEL.len_platforms].matrix);
+        BENCH_ESCAPE(matrix);
+    }
+}
+
+// NOTE: Reported per point rather than per batch.
+static void bench_transform(u64 iterations) {
+    for (u64 i = 0; i < iterations; i += BENCH_POINTS) {
+        transform(&BENCH.matrices[(i / BENCH_POINTS) & (BENCH_MATRICES - 1)],
+                  BENCH.points,
+                  BENCH.transformed,
+                  BENCH_POINTS);
+        BENCH_ESCAPE(BENCH.transformed);
+    }
+}
+
+static i32 bench_compare(const void* l, const void* r) {
+    const f64 a = *reinterpret_cast<const f64*>(l);
+    const f64 b = *reinterpret_cast<const f64*>(r);
+    return (a < b) ? -1 : (b < a) ? 1 : 0;
+}
+
+static void bench_run(const char* name, BenchFunc func) {
+    EXIT_IF(BENCH_CAP_RESULTS <= BENCH.len_results);
+    u64       iterations = 1;
+    const u64 warmup = pacing_now() + BENCH_WARMUP;
+    for (;;) {
+        const u64 start = pacing_now();
+        func(iterations);
+        const u64 end = pacing_now();
+        if ((end - start) < BENCH_SAMPLE) {
+            iterations *= 2;
+        } else if (warmup <= end) {
+            break;
+        }
+    }
+    for (u32 i = 0; i < BENCH_SAMPLES; ++i) {
+        const u64 start = pacing_now();
+        func(iterations);
+        BENCH.samples[i] = static_cast<f64>(pacing_now() - start) /
+                           static_cast<f64>(iterations);
+    }
+    qsort(BENCH.samples, BENCH_SAMPLES, sizeof(f64), bench_compare);
+    // NOTE: Distribution-free 95% interval for the median, from the order
+    // statistics `n/2 +/- 1.96 * sqrt(n) / 2`.
+    const u32 median = BENCH_SAMPLES / 2;
+    const u32 spread = static_cast<u32>(
+        ceil(1.96 * sqrt(static_cast<f64>(BENCH_SAMPLES)) / 2.0));
+    BenchResult* result = &BENCH.results[BENCH.len_results++];
+    result->name = name;
+    result->iterations = iterations;
+    result->median = BENCH.samples[median];
+    result->low = BENCH.samples[median - spread];
+    result->high = BENCH.samples[median + spread];
+    result->min = BENCH.samples[0];
+    printf("%-24s%12.2f%12.2f%12.2f%12.2f%12" PRIu64 "\n",
+           result->name,
+           result->median,
+           result->low,
+           result->high,
+           result->min,
+           result->iterations);
+}
+
+static void bench_write_json(const char* path) {
+    FILE* file = fopen(path, "w");
+    EXIT_IF(!file);
+    fprintf(file,
+            "{\"time\":%" PRIu64 ",\"unit\":\"ns\",\"samples\":%d,"
+            "\"results\":[",
+            static_cast<u64>(time(null)),
+            BENCH_SAMPLES);
+    for (u8 i = 0; i < BENCH.len_results; ++i) {
+        const BenchResult* result = &BENCH.results[i];
+        fprintf(file,
+                "%s\n{\"name\":\"%s\",\"median\":%.3f,\"low\":%.3f,"
+                "\"high\":%.3f,\"min\":%.3f,\"iterations\":%" PRIu64 "}",
+                i == 0 ? "" : ",",
+                result->name,
+                result->median,
+                result->low,
+                result->high,
+                result->min,
+                result->iterations);
+    }
+    fprintf(file, "\n]}\n");
+    EXIT_IF(fclose(file));
+}
+
+// NOTE: `bin/bench [--level <path>] [--json <path>]`; all times are
+// nanoseconds per iteration.
+i32 main(i32 argc, char** argv) {
+    {
+        const char* path = get_arg(argc, argv, "--level");
+        bench_set(path ? path : LEVEL_PATH);
+    }
+    printf("%-24s%12s%12s%12s%12s%12s\n",
+           "name",
+           "median",
+           "low",
+           "high",
+           "min",
+           "iterations");
+    bench_run("hash_set", bench_hash_build);
+    bench_run("hash_set_intersects/1", bench_hash_query<0>);
+    bench_run("hash_set_intersects/5", bench_hash_query<1>);
+    bench_run("hash_set_intersects/25", bench_hash_query<2>);
+    bench_run("set_motion", bench_set_motion);
+    if (BENCH.reach.offsets) {
+        bench_run("reach_find_paths", bench_reach_find_paths);
+    }
+    bench_run("sweep_update/100", bench_sweep_update<0>);
+    bench_run("sweep_update/1000", bench_sweep_update<1>);
+    bench_run("sweep_update/10000", bench_sweep_update<2>);
+    bench_run("sweep_update/100000", bench_sweep_update<3>);
+    bench_run("grid_pairs/100", bench_grid_pairs<0>);
+    bench_run("grid_pairs/1000", bench_grid_pairs<1>);
+    bench_run("grid_pairs/10000", bench_grid_pairs<2>);
+    bench_run("grid_pairs/100000", bench_grid_pairs<3>);
+    bench_run("mat4_multiply", bench_mat4_multiply);
+    bench_run("linear_combine", bench_linear_combine);
+    bench_run("look_at", bench_look_at);
+    bench_run("perspective", bench_perspective);
+    bench_run("camera", bench_camera);
+    bench_run("affine_inverse", bench_affine_inverse);
+    bench_run("transform", bench_transform);
+    {
+        const char* path = get_arg(argc, argv, "--json");
+        if (path) {
+            bench_write_json(path);
+        }
+    }
+    arena_close(&BENCH.build);
+    level_close();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#ifndef __BIND_H__
+#define __BIND_H__
+
+#include "init.hpp"
+
+// NOTE: Shadows the handful of bindings the per-frame path touches, so a
+// bind that wouldn't change anything never reaches the driver. Only valid
+// while every bind of these kinds goes through here; anything that deletes
+// a name which might be bound (GL quietly unbinds it, and the name can come
+// straight back from the next `glGen*`) must call `bind_reset` after.
+// Textures are only ever bound on unit `0`.
+struct Bind {
+    u32 program;
+    u32 vertex_array;
+    u32 read_frame_buffer;
+    u32 draw_frame_buffer;
+    u32 texture;
+    i32 viewport_width;
+    i32 viewport_height;
+};
+
+// NOTE: Zeroed matches a fresh context, apart from the viewport, which no
+// size ever compares equal to.
+static Bind BIND = {0, 0, 0, 0, 0, -1, -1};
+
+#define BIND_UNKNOWN 0xFFFFFFFF
+
+static void bind_reset() {
+    BIND.program = BIND_UNKNOWN;
+    BIND.vertex_array = BIND_UNKNOWN;
+    BIND.read_frame_buffer = BIND_UNKNOWN;
+    BIND.draw_frame_buffer = BIND_UNKNOWN;
+    BIND.texture = BIND_UNKNOWN;
+    BIND.viewport_width = -1;
+    BIND.viewport_height = -1;
+}
+
+static void bind_program(u32 program) {
+    if (BIND.program != program) {
+        glUseProgram(program);
+        BIND.program = program;
+    }
+}
+
+static void bind_vertex_array(u32 vertex_array) {
+    if (BIND.vertex_array != vertex_array) {
+        glBindVertexArray(vertex_array);
+        BIND.vertex_array = vertex_array;
+    }
+}
+
+static void bind_frame_buffer(u32 frame_buffer) {
+    if ((BIND.read_frame_buffer != frame_buffer) ||
+        (BIND.draw_frame_buffer != frame_buffer))
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+        BIND.read_frame_buffer = frame_buffer;
+        BIND.draw_frame_buffer = frame_buffer;
+    }
+}
+
+static void bind_read_frame_buffer(u32 frame_buffer) {
+    if (BIND.read_frame_buffer != frame_buffer) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_buffer);
+        BIND.read_frame_buffer = frame_buffer;
+    }
+}
+
+static void bind_draw_frame_buffer(u32 frame_buffer) {
+    if (BIND.draw_frame_buffer != frame_buffer) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame_buffer);
+        BIND.draw_frame_buffer = frame_buffer;
+    }
+}
+
+static void bind_texture(u32 texture) {
+    if (BIND.texture != texture) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        BIND.texture = texture;
+    }
+}
+
+static void bind_viewport(i32 width, i32 height) {
+    if ((BIND.viewport_width != width) || (BIND.viewport_height != height)) {
+        glViewport(0, 0, width, height);
+        BIND.viewport_width = width;
+        BIND.viewport_height = height;
+    }
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "histogram.hpp"
+#include "pacing.hpp"
+#include "scene.hpp"
+#include "triple.hpp"
+
+#include <pthread.h>
+#include <string.h>
+
+// NOTE: `--capture <path>` writes every frame's off-screen render target,
+// before it is scaled up to the window, to `<path>` as binary PPMs back to
+// back, each headed by a comment holding its frame index (`ffmpeg -f
+// image2pipe -c:v ppm -i <path>` reads the sequence). Each frame is read
+// into the next of `CAPTURE_FRAMES` pixel buffers, which the GPU fills
+// asynchronously, and is only mapped `CAPTURE_BUFFERS` frames later; by then
+// its fence has almost always signalled. The mapping itself goes to a writer
+// thread, which converts and writes it straight out of the buffer, and the
+// render thread unmaps it once the writer is done. So the render thread
+// never copies a frame or touches the disk.
+//
+// One file rather than one per frame: creating a file cost the writer about
+// four times what writing the frame into it does, and whenever it shares a
+// core with the render thread that time shows up in `capture_frame`.
+#define CAPTURE_BUFFERS 3
+#define CAPTURE_FRAMES  8
+
+// NOTE: Largest frame kept, in pixels; twice the finest resolution of a
+// `1920` by `1080` window.
+#define CAPTURE_CAP_PIXELS (1lu << 18)
+
+#define CAPTURE_PERIOD (NANOSECONDS / 1000lu)
+
+// NOTE: `pixels` is the buffer's mapping while the writer owns it: `RGBA`,
+// bottom row first, as GL reads it.
+struct CaptureBuffer {
+    GLsync    fence;
+    const u8* pixels;
+    u32       buffer;
+    i32       width;
+    i32       height;
+    u64       index;
+};
+
+// NOTE: Buffers go round in order. Those before `unmapped` are free, those
+// from there up to `tail` are written out but still mapped, those up to
+// `head` belong to the writer, and those up to `issued` are being read back.
+// `rgb` is the writer's scratch, and `file` its output.
+struct Capture {
+    CaptureBuffer           buffers[CAPTURE_FRAMES];
+    Histogram               cost;
+    u8*                     rgb;
+    FILE*                   file;
+    pthread_t               thread;
+    u64                     count;
+    u64                     issued;
+    u64                     unmapped;
+    u64                     dropped;
+    u64                     stalls;
+    alignas(CACHE_LINE) u64 head;
+    alignas(CACHE_LINE) u64 tail;
+    bool                    running;
+    bool                    enabled;
+};
+
+static Capture CAPTURE;
+
+// NOTE: Converts to `RGB` with the rows top first, then writes it all at
+// once.
+static void capture_write(const CaptureBuffer* buffer) {
+    const usize width = static_cast<usize>(buffer->width);
+    const usize height = static_cast<usize>(buffer->height);
+    u8*         rgb = CAPTURE.rgb;
+    for (usize i = height; 0 < i; --i) {
+        const u8* row = &buffer->pixels[(i - 1) * width * 4];
+        for (usize j = 0; j < width; ++j) {
+            *rgb++ = row[(j * 4) + 0];
+            *rgb++ = row[(j * 4) + 1];
+            *rgb++ = row[(j * 4) + 2];
+        }
+    }
+    fprintf(CAPTURE.file,
+            "P6\n# %06" PRIu64 "\n%zu %zu\n255\n",
+            buffer->index,
+            width,
+            height);
+    EXIT_IF(fwrite(CAPTURE.rgb, 1, width * height * 3, CAPTURE.file) !=
+            (width * height * 3));
+}
+
+// NOTE: Drains whatever is queued before exiting, so closing never loses a
+// frame that made it this far.
+static void* capture_flush(void*) {
+    TRACE_SET_THREAD("capture");
+    for (;;) {
+        const bool running =
+            __atomic_load_n(&CAPTURE.running, __ATOMIC_ACQUIRE);
+        const u64 head = __atomic_load_n(&CAPTURE.head, __ATOMIC_ACQUIRE);
+        if (CAPTURE.tail == head) {
+            if (!running) {
+                return null;
+            }
+            pacing_sleep_until(pacing_now() + CAPTURE_PERIOD);
+            continue;
+        }
+        capture_write(&CAPTURE.buffers[CAPTURE.tail % CAPTURE_FRAMES]);
+        __atomic_store_n(&CAPTURE.tail, CAPTURE.tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void capture_open(const char* path) {
+    CAPTURE.enabled = true;
+    CAPTURE.file = fopen(path, "wb");
+    if (!CAPTURE.file) {
+        EXIT_WITH(path);
+    }
+    CAPTURE.rgb = arena_alloc<u8>(&ARENAS.permanent, CAPTURE_CAP_PIXELS * 3);
+    for (u32 i = 0; i < CAPTURE_FRAMES; ++i) {
+        glGenBuffers(1, &CAPTURE.buffers[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, CAPTURE.buffers[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER,
+                     CAPTURE_CAP_PIXELS * 4,
+                     null,
+                     GL_STREAM_READ);
+        CAPTURE.buffers[i].fence = null;
+        CAPTURE.buffers[i].pixels = null;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    CHECK_GL_ERROR();
+    histogram_reset(&CAPTURE.cost);
+    __atomic_store_n(&CAPTURE.running, true, __ATOMIC_RELEASE);
+    EXIT_IF(pthread_create(&CAPTURE.thread, null, capture_flush, null));
+}
+
+// NOTE: Maps the buffer at `head` and hands it to the writer. Blocks only
+// if the GPU is more than `CAPTURE_BUFFERS - 1` frames behind, which is
+// counted in `stalls`.
+static void capture_map() {
+    CaptureBuffer* buffer = &CAPTURE.buffers[CAPTURE.head % CAPTURE_FRAMES];
+    if (glClientWaitSync(buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) ==
+        GL_TIMEOUT_EXPIRED)
+    {
+        ++CAPTURE.stalls;
+        EXIT_IF(glClientWaitSync(buffer->fence,
+                                 GL_SYNC_FLUSH_COMMANDS_BIT,
+                                 NANOSECONDS) == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(buffer->fence);
+    buffer->fence = null;
+    const usize size = static_cast<usize>(buffer->width) *
+                       static_cast<usize>(buffer->height) * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->buffer);
+    buffer->pixels = static_cast<const u8*>(glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER,
+        0,
+        static_cast<i64>(size),
+        GL_MAP_READ_BIT));
+    EXIT_IF(!buffer->pixels);
+    __atomic_store_n(&CAPTURE.head, CAPTURE.head + 1, __ATOMIC_RELEASE);
+}
+
+// NOTE: Takes back every buffer the writer is done with.
+static void capture_unmap() {
+    const u64 tail = __atomic_load_n(&CAPTURE.tail, __ATOMIC_ACQUIRE);
+    for (; CAPTURE.unmapped < tail; ++CAPTURE.unmapped) {
+        CaptureBuffer* buffer =
+            &CAPTURE.buffers[CAPTURE.unmapped % CAPTURE_FRAMES];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->buffer);
+        EXIT_IF(!glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        buffer->pixels = null;
+    }
+}
+
+// NOTE: Render thread, once per frame, after `scene_draw`. A frame is
+// dropped and counted, rather than waited on, when every buffer is still
+// with the writer or being read back.
+static void capture_frame() {
+    TRACE_SCOPE("capture_frame");
+    const u64 start = pacing_now();
+    capture_unmap();
+    if ((CAPTURE.issued - CAPTURE.head) == CAPTURE_BUFFERS) {
+        capture_map();
+    }
+    if ((CAPTURE_CAP_PIXELS < (static_cast<usize>(OBJECT.width) *
+                               static_cast<usize>(OBJECT.height))) ||
+        ((CAPTURE.issued - CAPTURE.unmapped) == CAPTURE_FRAMES))
+    {
+        ++CAPTURE.dropped;
+    } else {
+        CaptureBuffer* buffer =
+            &CAPTURE.buffers[CAPTURE.issued % CAPTURE_FRAMES];
+        bind_read_frame_buffer(OBJECT.frame_buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->buffer);
+        glReadPixels(0,
+                     0,
+                     OBJECT.width,
+                     OBJECT.height,
+                     GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     null);
+        buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        buffer->width = OBJECT.width;
+        buffer->height = OBJECT.height;
+        buffer->index = CAPTURE.count;
+        ++CAPTURE.issued;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    CHECK_GL_ERROR();
+    ++CAPTURE.count;
+    histogram_add(&CAPTURE.cost, pacing_now() - start);
+}
+
+static void capture_close() {
+    while (CAPTURE.head < CAPTURE.issued) {
+        capture_map();
+    }
+    __atomic_store_n(&CAPTURE.running, false, __ATOMIC_RELEASE);
+    EXIT_IF(pthread_join(CAPTURE.thread, null));
+    EXIT_IF(fclose(CAPTURE.file));
+    capture_unmap();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    for (u32 i = 0; i < CAPTURE_FRAMES; ++i) {
+        glDeleteBuffers(1, &CAPTURE.buffers[i].buffer);
+    }
+    const HistogramSummary summary = histogram_get_summary(&CAPTURE.cost);
+    printf("capture  %8" PRIu64 " frames %8" PRIu64 " dropped %8" PRIu64
+           " stalls %10.3f ms p50 %10.3f ms p99 %10.3f ms max\n",
+           CAPTURE.count,
+           CAPTURE.dropped,
+           CAPTURE.stalls,
+           static_cast<f64>(summary.p50) / NANOSECONDS_PER_MILLISECOND,
+           static_cast<f64>(summary.p99) / NANOSECONDS_PER_MILLISECOND,
+           static_cast<f64>(summary.max) / NANOSECONDS_PER_MILLISECOND);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#version 330 core
+
+precision highp float;
+
+layout(location = 0) in vec3 IN_BOTTOM_LEFT_FRONT;
+layout(location = 1) in vec3 IN_TOP_RIGHT_BACK;
+
+// NOTE: Laid out to match `SceneFrame`; shared with `vert.glsl`.
+layout(std140) uniform FRAME {
+    mat4 PROJECTION;
+    mat4 VIEW;
+    vec3 POSITION;
+};
+
+uniform sampler2D HI_Z;
+uniform int       LEVELS;
+
+out float CULL_OUT_VISIBLE;
+
+void main() {
+    mat4 transform = PROJECTION * VIEW;
+    vec3 lower = vec3(3.0e38);
+    vec3 upper = vec3(-3.0e38);
+    int  behind = 0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = mix(IN_BOTTOM_LEFT_FRONT,
+                          IN_TOP_RIGHT_BACK,
+                          vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = transform * vec4(corner, 1.0);
+        if (clip.w <= 0.0) {
+            ++behind;
+            continue;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        lower = min(lower, ndc);
+        upper = max(upper, ndc);
+    }
+    if (behind == 8) {
+        CULL_OUT_VISIBLE = 0.0;
+        return;
+    }
+    // NOTE: Box straddles the eye; projected bounds are meaningless, so keep
+    // it.
+    if (behind != 0) {
+        CULL_OUT_VISIBLE = 1.0;
+        return;
+    }
+    if (any(greaterThan(lower, vec3(1.0))) ||
+        any(lessThan(upper.xy, vec2(-1.0))))
+    {
+        CULL_OUT_VISIBLE = 0.0;
+        return;
+    }
+    ivec2 size = textureSize(HI_Z, 0);
+    vec2  uv_lower = clamp((lower.xy * 0.5) + 0.5, 0.0, 1.0);
+    vec2  uv_upper = clamp((upper.xy * 0.5) + 0.5, 0.0, 1.0);
+    vec2  extent = (uv_upper - uv_lower) * vec2(size);
+    // NOTE: Pick the level where the box spans at most one texel, so four
+    // fetches cover it.
+    int   level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))),
+                      0,
+                      LEVELS - 1);
+    // NOTE: Derived rather than queried; `llvmpipe` answers
+    // `textureSize(HI_Z, level)` with some other lane's `level` when it
+    // diverges across a batch.
+    ivec2 last = max(size >> level, ivec2(1)) - 1;
+    ivec2 a = clamp(ivec2(uv_lower * vec2(last + 1)), ivec2(0), last);
+    ivec2 b = clamp(ivec2(uv_upper * vec2(last + 1)), ivec2(0), last);
+    float depth = max(max(texelFetch(HI_Z, a, level).r,
+                          texelFetch(HI_Z, ivec2(b.x, a.y), level).r),
+                      max(texelFetch(HI_Z, ivec2(a.x, b.y), level).r,
+                          texelFetch(HI_Z, b, level).r));
+    CULL_OUT_VISIBLE = ((lower.z * 0.5) + 0.5) <= depth ? 1.0 : 0.0;
+}
@@ -0,0 +1,339 @@
+#include "level.hpp"
+#include "player.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE: Writes procedural stress levels in the format `bin/codegen` exports,
+// e.g. `bin/generate clustered 100000 7 bin/clustered.level`. The same
+// `<seed>` always produces the same file.
+//
+// Platforms are laid out on a lattice of columns (along `x`) and rows (along
+// `z`), each with its own size and the gap after it, so no two platforms can
+// overlap and every platform is at most `GENERATE_GAP_MAX` from its
+// neighbours. Heights are the sum of one random walk over columns and one
+// over rows, each stepping at most half of `GENERATE_RISE_MAX`, so
+// neighbours are always within a single jump. Platform `0` sits under the
+// spawn point.
+#define GENERATE_GAP_MAX  (JUMP_DISTANCE * 0.4f)
+#define GENERATE_RISE_MAX (JUMP_HEIGHT * 0.5f)
+
+#define GENERATE_THICKNESS 0.5f
+#define GENERATE_Y         20.0f
+#define GENERATE_WALK_MAX  10.0f
+
+#define GENERATE_LEN_MIN 1u
+#define GENERATE_LEN_MAX 10000000u
+
+#define GENERATE_UNIFORM    0
+#define GENERATE_CLUSTERED  1
+#define GENERATE_TOWERS     2
+#define GENERATE_SPARSE     3
+#define GENERATE_MIXED      4
+#define GENERATE_CAP_LAYOUT 5
+
+// NOTE: `clustered` packs small platforms tightly and opens a near-maximal
+// gap every `GENERATE_CLUSTER` columns and rows.
+#define GENERATE_CLUSTER 16
+
+// NOTE: Every `towers` tile but the first is a ground slab with a spiral
+// staircase on top: step `i` covers quadrant `i % 4` and rises
+// `GENERATE_RISE_MAX` over step `i - 1`. A step and the one four above it
+// must leave room to jump from the lower without hitting the upper.
+#define GENERATE_TOWER_STEP      8.0f
+#define GENERATE_TOWER_GAP       1.0f
+#define GENERATE_TOWER_STEPS_MIN 8u
+#define GENERATE_TOWER_STEPS_MAX 32u
+#define GENERATE_TOWER_WIDTH \
+    ((GENERATE_TOWER_STEP * 2.0f) + GENERATE_TOWER_GAP)
+
+static_assert(PLAYER_HEIGHT + JUMP_HEIGHT <
+                  (GENERATE_RISE_MAX * 4.0f) - GENERATE_THICKNESS,
+              "Tower steps are stacked too tightly");
+static_assert((GENERATE_TOWER_GAP + PLAYER_WIDTH) < GENERATE_GAP_MAX,
+              "Tower steps are too far apart");
+
+struct Lattice {
+    f32* x;
+    f32* z;
+    f32* width;
+    f32* depth;
+    f32* height_x;
+    f32* height_z;
+    u32  columns;
+    u32  rows;
+};
+
+struct Generate {
+    Arena     arena;
+    Lattice   lattice;
+    Instance* instances;
+    Cube*     platforms;
+    u32       len_platforms;
+    u32       cap_platforms;
+    u32       seed;
+    u8        layout;
+};
+
+static Generate GENERATE;
+
+static const char* GENERATE_LAYOUTS[GENERATE_CAP_LAYOUT] = {
+    "uniform",
+    "clustered",
+    "towers",
+    "sparse-huge",
+    "mixed-size",
+};
+
+static u32 generate_get_random() {
+    GENERATE.seed ^= GENERATE.seed << 13;
+    GENERATE.seed ^= GENERATE.seed >> 17;
+    GENERATE.seed ^= GENERATE.seed << 5;
+    return GENERATE.seed;
+}
+
+static f32 generate_get_random_f32(f32 l, f32 r) {
+    return l + ((r - l) * (static_cast<f32>(generate_get_random() >> 8) /
+                           static_cast<f32>(1 << 24)));
+}
+
+// NOTE: Log-uniform, so small platforms are as common as large ones are
+// rare, rather than nearly absent.
+static f32 generate_get_random_log(f32 l, f32 r) {
+    return expf(generate_get_random_f32(logf(l), logf(r)));
+}
+
+static u32 generate_get_random_u32(u32 l, u32 r) {
+    return l + (generate_get_random() % ((r - l) + 1));
+}
+
+static f32 generate_get_size() {
+    if (GENERATE.layout == GENERATE_UNIFORM) {
+        return 10.0f;
+    }
+    if (GENERATE.layout == GENERATE_CLUSTERED) {
+        return generate_get_random_f32(3.0f, 8.0f);
+    }
+    if (GENERATE.layout == GENERATE_TOWERS) {
+        return GENERATE_TOWER_WIDTH;
+    }
+    if (GENERATE.layout == GENERATE_SPARSE) {
+        return generate_get_random_f32(40.0f, 200.0f);
+    }
+    EXIT_IF(GENERATE.layout != GENERATE_MIXED);
+    return generate_get_random_log(2.0f, 60.0f);
+}
+
+// NOTE: Gaps never drop below `PLAYER_WIDTH`, so the player can always fall
+// between neighbours instead of snagging on a seam.
+static f32 generate_get_gap(u32 index) {
+    if (GENERATE.layout == GENERATE_UNIFORM) {
+        return generate_get_random_f32(GENERATE_GAP_MAX * 0.25f,
+                                       GENERATE_GAP_MAX * 0.5f);
+    }
+    if (GENERATE.layout == GENERATE_CLUSTERED) {
+        if ((index % GENERATE_CLUSTER) == (GENERATE_CLUSTER - 1)) {
+            return generate_get_random_f32(GENERATE_GAP_MAX * 0.8f,
+                                           GENERATE_GAP_MAX);
+        }
+        return generate_get_random_f32(PLAYER_WIDTH, PLAYER_WIDTH * 2.0f);
+    }
+    if (GENERATE.layout == GENERATE_TOWERS) {
+        return generate_get_random_f32(PLAYER_WIDTH, GENERATE_GAP_MAX * 0.5f);
+    }
+    if (GENERATE.layout == GENERATE_SPARSE) {
+        return generate_get_random_f32(GENERATE_GAP_MAX * 0.6f,
+                                       GENERATE_GAP_MAX);
+    }
+    EXIT_IF(GENERATE.layout != GENERATE_MIXED);
+    return generate_get_random_f32(PLAYER_WIDTH, GENERATE_GAP_MAX);
+}
+
+static f32 generate_get_walk(f32 height) {
+    const f32 step = GENERATE_RISE_MAX / 2.0f;
+    return MAX(-GENERATE_WALK_MAX,
+               MIN(height + generate_get_random_f32(-step, step),
+                   GENERATE_WALK_MAX));
+}
+
+// NOTE: Lays out `len` cells along one axis, centring the first on `origin`.
+static void generate_set_axis(f32* positions,
+                              f32* sizes,
+                              f32* heights,
+                              u32  len,
+                              f32  origin) {
+    positions[0] = origin;
+    sizes[0] = generate_get_size();
+    heights[0] = 0.0f;
+    for (u32 i = 1; i < len; ++i) {
+        sizes[i] = generate_get_size();
+        positions[i] = positions[i - 1] + (sizes[i - 1] / 2.0f) +
+                       generate_get_gap(i - 1) + (sizes[i] / 2.0f);
+        heights[i] = generate_get_walk(heights[i - 1]);
+    }
+}
+
+// NOTE: Square-ish, with enough rows for `len_tiles` however many platforms
+// each tile turns out to hold.
+static void generate_set_lattice(u32 len_tiles) {
+    Lattice* lattice = &GENERATE.lattice;
+    lattice->columns =
+        MAX(1u, static_cast<u32>(ceilf(sqrtf(static_cast<f32>(len_tiles)))));
+    lattice->rows =
+        ((GENERATE.cap_platforms + lattice->columns) - 1) / lattice->columns;
+    lattice->x = arena_alloc<f32>(&GENERATE.arena, lattice->columns);
+    lattice->width = arena_alloc<f32>(&GENERATE.arena, lattice->columns);
+    lattice->height_x = arena_alloc<f32>(&GENERATE.arena, lattice->columns);
+    lattice->z = arena_alloc<f32>(&GENERATE.arena, lattice->rows);
+    lattice->depth = arena_alloc<f32>(&GENERATE.arena, lattice->rows);
+    lattice->height_z = arena_alloc<f32>(&GENERATE.arena, lattice->rows);
+    const Vec3 spawn = INIT_PLAYER_POSITION;
+    generate_set_axis(lattice->x,
+                      lattice->width,
+                      lattice->height_x,
+                      lattice->columns,
+                      spawn.x);
+    generate_set_axis(lattice->z,
+                      lattice->depth,
+                      lattice->height_z,
+                      lattice->rows,
+                      spawn.z);
+}
+
+static void generate_push(Vec3 position, Vec3 size) {
+    EXIT_IF(GENERATE.cap_platforms <= GENERATE.len_platforms);
+    const u32 index = GENERATE.len_platforms++;
+    level_set_platform(&GENERATE.instances[index],
+                       &GENERATE.platforms[index],
+                       translate(position) * scale(size),
+                       index);
+}
+
+// NOTE: The staircase starts one rise above the slab and winds around its
+// quadrants; the first tile stays flat so nothing hangs over the spawn.
+static void generate_push_tower(Vec3 position, u32 tile) {
+    generate_push(position,
+                  {GENERATE_TOWER_WIDTH,
+                   GENERATE_THICKNESS,
+                   GENERATE_TOWER_WIDTH});
+    if (tile == 0) {
+        return;
+    }
+    static const Vec3 QUADRANTS[4] = {
+        {-1.0f, 0.0f, -1.0f},
+        {1.0f, 0.0f, -1.0f},
+        {1.0f, 0.0f, 1.0f},
+        {-1.0f, 0.0f, 1.0f},
+    };
+    const f32 offset = (GENERATE_TOWER_STEP + GENERATE_TOWER_GAP) / 2.0f;
+    const u32 len_steps = MIN(
+        generate_get_random_u32(GENERATE_TOWER_STEPS_MIN,
+                                GENERATE_TOWER_STEPS_MAX),
+        GENERATE.cap_platforms - GENERATE.len_platforms);
+    for (u32 i = 0; i < len_steps; ++i) {
+        const Vec3 quadrant = QUADRANTS[i % 4];
+        generate_push(
+            {
+                position.x + (quadrant.x * offset),
+                position.y + (static_cast<f32>(i + 1) * GENERATE_RISE_MAX),
+                position.z + (quadrant.z * offset),
+            },
+            {GENERATE_TOWER_STEP, GENERATE_THICKNESS, GENERATE_TOWER_STEP});
+    }
+}
+
+static void generate_set_platforms() {
+    const Lattice* lattice = &GENERATE.lattice;
+    for (u32 tile = 0; GENERATE.len_platforms < GENERATE.cap_platforms;
+         ++tile)
+    {
+        const u32 column = tile % lattice->columns;
+        const u32 row = tile / lattice->columns;
+        EXIT_IF(lattice->rows <= row);
+        const Vec3 position = {
+            lattice->x[column],
+            GENERATE_Y + lattice->height_x[column] + lattice->height_z[row],
+            lattice->z[row],
+        };
+        if (GENERATE.layout == GENERATE_TOWERS) {
+            generate_push_tower(position, tile);
+            continue;
+        }
+        generate_push(position,
+                      {lattice->width[column],
+                       GENERATE_THICKNESS,
+                       lattice->depth[row]});
+    }
+}
+
+static u8 generate_get_layout(const char* name) {
+    for (u8 i = 0; i < GENERATE_CAP_LAYOUT; ++i) {
+        if (!strcmp(name, GENERATE_LAYOUTS[i])) {
+            return i;
+        }
+    }
+    EXIT_WITH(name);
+}
+
+i32 main(i32 argc, char** argv) {
+    if (argc != 5) {
+        fprintf(stderr,
+                "usage: %s "
+                "uniform|clustered|towers|sparse-huge|mixed-size "
+                "<count> <seed> <level>\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    GENERATE.layout = generate_get_layout(argv[1]);
+    {
+        const u64 len = strtoul(argv[2], null, 10);
+        EXIT_IF((len < GENERATE_LEN_MIN) || (GENERATE_LEN_MAX < len));
+        GENERATE.cap_platforms = static_cast<u32>(len);
+    }
+    GENERATE.seed = static_cast<u32>(strtoul(argv[3], null, 10));
+    EXIT_IF(GENERATE.seed == 0);
+    {
+        // NOTE: Instances and platforms, the lattice, and what `level_write`
+        // builds: sort keys, sorted platforms, chunks, and the grid, which is
+        // bounded by the 8 cells any platform smaller than a cell can touch.
+        const usize size =
+            (GENERATE.cap_platforms *
+             (sizeof(Instance) + sizeof(Cube) + (sizeof(f32) * 6) +
+              sizeof(LevelKey) + sizeof(Cube) + sizeof(LevelChunk))) +
+            hash_get_size(GENERATE.cap_platforms,
+                          GENERATE.cap_platforms * 8) +
+            (1lu << 24);
+        arena_open(&GENERATE.arena,
+                   "generate",
+                   (size + (ARENA_HUGE_PAGE - 1)) & ~(ARENA_HUGE_PAGE - 1),
+                   ARENA_PAGES_TRANSPARENT);
+    }
+    GENERATE.instances =
+        arena_alloc<Instance>(&GENERATE.arena, GENERATE.cap_platforms);
+    GENERATE.platforms =
+        arena_alloc<Cube>(&GENERATE.arena, GENERATE.cap_platforms);
+    generate_set_lattice(
+        GENERATE.layout == GENERATE_TOWERS
+            ? (GENERATE.cap_platforms /
+               (((GENERATE_TOWER_STEPS_MIN + GENERATE_TOWER_STEPS_MAX) / 2) +
+                1)) +
+                  1
+            : GENERATE.cap_platforms);
+    generate_set_platforms();
+    // NOTE: No reachability graph; at these sizes simulating it would take
+    // far longer than everything else combined.
+    level_write(argv[4],
+                GENERATE.instances,
+                GENERATE.platforms,
+                GENERATE.len_platforms,
+                false,
+                &GENERATE.arena);
+    printf("%s : %u platforms (%s, seed %s), %zu bytes of arena\n",
+           argv[4],
+           GENERATE.len_platforms,
+           GENERATE_LAYOUTS[GENERATE.layout],
+           argv[3],
+           GENERATE.arena.high_water);
+    arena_close(&GENERATE.arena);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+#include "arena.hpp"
+#include "init_assets_codegen.hpp"
+#include "level.hpp"
+#include "pacing.hpp"
+#include "scene.hpp"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE: Renders a scripted camera path through the level with no window or
+// display server, and reports frames per second and a checksum of the last
+// frame. Nothing depends on the clock: the camera orbits the level's bounds
+// by a fixed angle per frame, the resolution controller is left out, and
+// every frame is finished before the next starts, so the rate is what one
+// frame costs rather than how deep the driver will queue.
+#define HEADLESS_WIDTH  (1 << 10)
+#define HEADLESS_HEIGHT ((1 << 9) + (1 << 8))
+#define HEADLESS_SCALE  4
+#define HEADLESS_FRAMES 600
+
+#define HEADLESS_BUFFER_WIDTH  (HEADLESS_WIDTH / HEADLESS_SCALE)
+#define HEADLESS_BUFFER_HEIGHT (HEADLESS_HEIGHT / HEADLESS_SCALE)
+
+// NOTE: One lap every `HEADLESS_FRAMES` frames, from `HEADLESS_RADIUS`
+// half-widths out and `HEADLESS_ELEVATION` times that above the top.
+#define HEADLESS_STEP      ((2.0f * PI) / HEADLESS_FRAMES)
+#define HEADLESS_RADIUS    1.25f
+#define HEADLESS_ELEVATION 0.5f
+
+#define HEADLESS_CAP_CHARS (1 << 10)
+
+struct Offscreen {
+    BufferMemory<HEADLESS_CAP_CHARS> buffer;
+    Vec3                             center;
+    f32                              radius;
+    f32                              height;
+    Mat4                             projection;
+    u8 pixels[HEADLESS_BUFFER_WIDTH * HEADLESS_BUFFER_HEIGHT * 3];
+};
+
+static Offscreen OFFSCREEN;
+
+static void headless_set_path() {
+    EXIT_IF(LEVEL.len_platforms == 0);
+    Vec3 bottom_left_front = LEVEL.platforms[0].bottom_left_front;
+    Vec3 top_right_back = LEVEL.platforms[0].top_right_back;
+    for (u32 i = 1; i < LEVEL.len_platforms; ++i) {
+        bottom_left_front =
+            min(bottom_left_front, LEVEL.platforms[i].bottom_left_front);
+        top_right_back =
+            max(top_right_back, LEVEL.platforms[i].top_right_back);
+    }
+    OFFSCREEN.center = (bottom_left_front + top_right_back) / 2.0f;
+    Vec3 extent = (top_right_back - bottom_left_front) / 2.0f;
+    extent.y = 0.0f;
+    OFFSCREEN.radius = len(extent) * HEADLESS_RADIUS;
+    OFFSCREEN.height = (top_right_back.y - OFFSCREEN.center.y) +
+                       (OFFSCREEN.radius * HEADLESS_ELEVATION);
+}
+
+static void headless_set_frame(u64 frame) {
+    const f32  radians = static_cast<f32>(frame) * HEADLESS_STEP;
+    const Vec3 offset = {
+        cosf(radians) * OFFSCREEN.radius,
+        OFFSCREEN.height,
+        sinf(radians) * OFFSCREEN.radius,
+    };
+    const Vec3 position = OFFSCREEN.center + offset;
+    const Mat4 view = look_at(position, OFFSCREEN.center, {0.0f, 1.0f, 0.0f});
+    scene_set_frame(&OFFSCREEN.projection, &view, position);
+}
+
+// NOTE: `FNV-1a` over the off-screen target's `RGB` bytes.
+static u64 headless_get_checksum() {
+    bind_read_frame_buffer(OBJECT.frame_buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0,
+                 0,
+                 HEADLESS_BUFFER_WIDTH,
+                 HEADLESS_BUFFER_HEIGHT,
+                 GL_RGB,
+                 GL_UNSIGNED_BYTE,
+                 OFFSCREEN.pixels);
+    CHECK_GL_ERROR();
+    u64 hash = INIT_HASH_OFFSET;
+    for (usize i = 0; i < sizeof(OFFSCREEN.pixels); ++i) {
+        hash = (hash ^ OFFSCREEN.pixels[i]) * INIT_HASH_PRIME;
+    }
+    return hash;
+}
+
+i32 main(i32 argc, char** argv) {
+    arena_set(ARENA_PAGES_NORMAL);
+    u64 frames = HEADLESS_FRAMES;
+    {
+        const char* arg = get_arg(argc, argv, "--frames");
+        if (arg) {
+            frames = strtoul(arg, null, 10);
+            EXIT_IF(frames == 0);
+        }
+    }
+    EGLDisplay display = init_get_context<HEADLESS_WIDTH, HEADLESS_HEIGHT>();
+    printf("%s | %s\n",
+           reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+           reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    {
+        const char* path = get_arg(argc, argv, "--level");
+        level_open(path ? path : LEVEL_PATH, false);
+    }
+    headless_set_path();
+    const u32            scaled =
+        (LEVEL.header->flags & LEVEL_SCALED) ? SHADER_SCALED : 0;
+    const ShaderVariant* variant = &SHADER_VARIANTS[scaled];
+    const u32            program =
+        init_get_program(&OFFSCREEN.buffer,
+                         init_get_shader(&OFFSCREEN.buffer,
+                                         variant->vert,
+                                         GL_VERTEX_SHADER),
+                         init_get_shader(&OFFSCREEN.buffer,
+                                         variant->frag,
+                                         GL_FRAGMENT_SHADER));
+    occlusion_set_programs(&OFFSCREEN.buffer, &ARENAS.frame);
+    scene_set_buffers(HEADLESS_BUFFER_WIDTH,
+                      HEADLESS_BUFFER_HEIGHT,
+                      LEVEL.instances,
+                      LEVEL.platforms,
+                      LEVEL.len_platforms);
+    scene_set_program(program);
+    timer_set_queries(null);
+    OFFSCREEN.projection = perspective(get_radians(45.0f),
+                                       static_cast<f32>(HEADLESS_WIDTH) /
+                                           static_cast<f32>(HEADLESS_HEIGHT),
+                                       0.1f,
+                                       1000.0f);
+    const u64 start = pacing_now();
+    for (u64 i = 0; i < frames; ++i) {
+        headless_set_frame(i);
+        scene_draw(HEADLESS_WIDTH, HEADLESS_HEIGHT);
+        glFinish();
+    }
+    const f64 elapsed = static_cast<f64>(pacing_now() - start) / NANOSECONDS;
+    const u64 checksum = headless_get_checksum();
+    printf("headless %8" PRIu64 " frames %10.3f ms/frame %10.1f frames/s "
+           "checksum %016" PRIx64 "\n",
+           frames,
+           (elapsed * 1000.0) / static_cast<f64>(frames),
+           static_cast<f64>(frames) / elapsed,
+           checksum);
+    timer_delete_queries();
+    scene_delete_buffers();
+    occlusion_delete_programs();
+    level_close();
+    glDeleteProgram(program);
+    EXIT_IF(!eglTerminate(display));
+    arena_delete();
+    const char* golden = get_arg(argc, argv, "--golden");
+    if (golden && (strtoull(golden, null, 16) != checksum)) {
+        fprintf(stderr,
+                "checksum %016" PRIx64 " != golden %s\n",
+                checksum,
+                golden);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include "math.hpp"
+
+#include <string.h>
+
+// NOTE: Log-linear buckets in the style of `HdrHistogram`: every power of two
+// is split into `HISTOGRAM_SUB` linear steps, so any value is recorded within
+// ~1% of its true size from nanoseconds up to `2^HISTOGRAM_BITS` (~68s).
+// Recording is a `clz`, a shift, and an increment; nothing is allocated.
+#define HISTOGRAM_SUB_BITS 7
+#define HISTOGRAM_SUB      (1u << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BITS     36
+#define HISTOGRAM_BUCKETS \
+    ((HISTOGRAM_BITS - HISTOGRAM_SUB_BITS + 1u) * HISTOGRAM_SUB)
+
+struct Histogram {
+    u32 buckets[HISTOGRAM_BUCKETS];
+    u64 max;
+    u32 count;
+};
+
+// NOTE: Every value recorded here is in nanoseconds; readers divide by this
+// to print milliseconds.
+#define NANOSECONDS_PER_MILLISECOND 1000000.0
+
+// NOTE: All in nanoseconds.
+struct HistogramSummary {
+    u64 p50;
+    u64 p99;
+    u64 p999;
+    u64 max;
+    u32 count;
+};
+
+static u32 histogram_get_bucket(u64 value) {
+    if (value < HISTOGRAM_SUB) {
+        return static_cast<u32>(value);
+    }
+    const u32 exponent = static_cast<u32>(63 - __builtin_clzll(value));
+    if (HISTOGRAM_BITS <= exponent) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    const u32 shift = exponent - HISTOGRAM_SUB_BITS;
+    return static_cast<u32>(((shift + 1) * HISTOGRAM_SUB) +
+                            ((value >> shift) & (HISTOGRAM_SUB - 1)));
+}
+
+// NOTE: Largest value that lands in `bucket`, so percentiles round up rather
+// than flatter the tail.
+static u64 histogram_get_value(u32 bucket) {
+    if (bucket < HISTOGRAM_SUB) {
+        return bucket;
+    }
+    const u32 shift = (bucket / HISTOGRAM_SUB) - 1;
+    const u64 mantissa = HISTOGRAM_SUB + (bucket % HISTOGRAM_SUB);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+static void histogram_add(Histogram* histogram, u64 value) {
+    ++histogram->buckets[histogram_get_bucket(value)];
+    histogram->max = MAX(histogram->max, value);
+    ++histogram->count;
+}
+
+static void histogram_reset(Histogram* histogram) {
+    memset(histogram, 0, sizeof(Histogram));
+}
+
+static u64 histogram_get_percentile(const Histogram* histogram,
+                                    u64              numerator,
+                                    u64              denominator) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    const u64 rank =
+        ((histogram->count * numerator) + (denominator - 1)) / denominator;
+    u64 total = 0;
+    for (u32 i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        total += histogram->buckets[i];
+        if (rank <= total) {
+            return MIN(histogram_get_value(i), histogram->max);
+        }
+    }
+    return histogram->max;
+}
+
+static HistogramSummary histogram_get_summary(const Histogram* histogram) {
+    return {
+        histogram_get_percentile(histogram, 50, 100),
+        histogram_get_percentile(histogram, 99, 100),
+        histogram_get_percentile(histogram, 999, 1000),
+        histogram->max,
+        histogram->count,
+    };
+}
+
+// NOTE: The last `HISTOGRAM_SLICES` windows rather than only the latest. A
+// one second window holds about sixty frames, and at that count p99 and
+// p99.9 are both just the max; twenty of them hold enough for p99.9 to mean
+// something while a summary still comes out every window.
+#define HISTOGRAM_SLICES 20
+
+struct HistogramRolling {
+    Histogram slices[HISTOGRAM_SLICES];
+    Histogram total;
+    u32       slice;
+};
+
+static void histogram_rolling_reset(HistogramRolling* rolling) {
+    memset(rolling, 0, sizeof(HistogramRolling));
+}
+
+static void histogram_rolling_add(HistogramRolling* rolling, u64 value) {
+    histogram_add(&rolling->slices[rolling->slice], value);
+    histogram_add(&rolling->total, value);
+}
+
+// NOTE: Summarizes every slice so far, then drops the oldest from `total` and
+// starts recording over it.
+static HistogramSummary histogram_rolling_next(HistogramRolling* rolling) {
+    const HistogramSummary summary = histogram_get_summary(&rolling->total);
+    rolling->slice = (rolling->slice + 1) % HISTOGRAM_SLICES;
+    Histogram* oldest = &rolling->slices[rolling->slice];
+    for (u32 i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        rolling->total.buckets[i] -= oldest->buckets[i];
+    }
+    rolling->total.count -= oldest->count;
+    histogram_reset(oldest);
+    rolling->total.max = 0;
+    for (u32 i = 0; i < HISTOGRAM_SLICES; ++i) {
+        rolling->total.max = MAX(rolling->total.max, rolling->slices[i].max);
+    }
+    return summary;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#version 330 core
+
+precision highp float;
+
+// NOTE: Either the depth attachment or the previous `Hi-Z` level, exposed as
+// level `0` via `GL_TEXTURE_BASE_LEVEL`.
+uniform sampler2D DEPTH;
+
+layout(location = 0) out float FRAG_OUT_DEPTH;
+
+float fetch(ivec2 coord, ivec2 last) {
+    return texelFetch(DEPTH, min(coord, last), 0).r;
+}
+
+void main() {
+    ivec2 last = textureSize(DEPTH, 0) - 1;
+    ivec2 coord = ivec2(gl_FragCoord.xy) * 2;
+    float depth = max(max(fetch(coord, last),
+                          fetch(coord + ivec2(1, 0), last)),
+                      max(fetch(coord + ivec2(0, 1), last),
+                          fetch(coord + ivec2(1, 1), last)));
+    // NOTE: Odd dimensions fold the leftover row/column into the last texel,
+    // otherwise it would never be covered by the pyramid.
+    bvec2 odd = equal(coord + 2, last);
+    if (odd.x) {
+        depth = max(depth,
+                    max(fetch(coord + ivec2(2, 0), last),
+                        fetch(coord + ivec2(2, 1), last)));
+    }
+    if (odd.y) {
+        depth = max(depth,
+                    max(fetch(coord + ivec2(0, 2), last),
+                        fetch(coord + ivec2(1, 2), last)));
+    }
+    if (odd.x && odd.y) {
+        depth = max(depth, fetch(coord + ivec2(2, 2), last));
+    }
+    FRAG_OUT_DEPTH = depth;
+}
@@ -1,7 +1,7 @@
 #ifndef __INIT_H__
 #define __INIT_H__
 
-#include "prelude.hpp"
+#include "arena.hpp"
 
 #define GL_GLEXT_PROTOTYPES
 
@@ -9,6 +9,16 @@
 #pragma GCC diagnostic ignored "-Wdocumentation"
 #pragma GCC diagnostic ignored "-Wdocumentation-unknown-command"
 
+// NOTE: `-DHEADLESS` builds against EGL alone, without GLFW or X11; see
+// `init_get_context`.
+#ifdef HEADLESS
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+
+#else
+
 #include <GLFW/glfw3.h>
 
 // NOTE: This is a hack to hide the mouse cursor; at the moment, seems like
@@ -18,20 +28,157 @@
 
 #include <GLFW/glfw3native.h>
 
+#endif
+
 #pragma GCC diagnostic pop
 
+#ifndef HEADLESS
 #include <X11/extensions/Xfixes.h>
+#endif
 
-struct Native {
-    Display* display;
-    Window   window;
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+// NOTE: `glGetError` can stall the driver until it catches up with
+// everything queued, so `-DRELEASE` drops the checks altogether.
+#ifdef RELEASE
+
+#define CHECK_GL_ERROR() \
+    {                    \
+    }
+
+#else
+
+#define CHECK_GL_ERROR()                                   \
+    {                                                      \
+        switch (glGetError()) {                            \
+        case GL_INVALID_ENUM: {                            \
+            EXIT_WITH("GL_INVALID_ENUM");                  \
+        }                                                  \
+        case GL_INVALID_VALUE: {                           \
+            EXIT_WITH("GL_INVALID_VALUE");                 \
+        }                                                  \
+        case GL_INVALID_OPERATION: {                       \
+            EXIT_WITH("GL_INVALID_OPERATION");             \
+        }                                                  \
+        case GL_INVALID_FRAMEBUFFER_OPERATION: {           \
+            EXIT_WITH("GL_INVALID_FRAMEBUFFER_OPERATION"); \
+        }                                                  \
+        case GL_OUT_OF_MEMORY: {                           \
+            EXIT_WITH("GL_OUT_OF_MEMORY");                 \
+        }                                                  \
+        case GL_NO_ERROR: {                                \
+            break;                                         \
+        }                                                  \
+        }                                                  \
+    }
+
+#endif
+
+// NOTE: Linked programs are cached on disk, one file per program, keyed by a
+// hash of the driver's vendor, renderer, and version strings and of every
+// source that went into the program. Anything the driver then refuses (an
+// update that didn't show up in those strings, a torn write) is rebuilt from
+// source and overwritten, so a bad entry costs one compile.
+#define INIT_CACHE_PATH  "bin/cache"
+#define INIT_CACHE_MAGIC 0x6368706A
+#define INIT_CAP_PATH    64
+
+#define INIT_HASH_OFFSET 0xCBF29CE484222325lu
+#define INIT_HASH_PRIME  0x100000001B3lu
+
+struct InitCacheHeader {
+    u32 magic;
+    u32 format;
+    u64 key;
+    u64 size;
 };
 
+struct InitCache {
+    u64  driver;
+    u32  hits;
+    u32  misses;
+    bool enabled;
+};
+
+static InitCache INIT_CACHE;
+
 template <usize N>
 struct BufferMemory {
     char buffer[N];
 };
 
+#ifdef HEADLESS
+
+// NOTE: A `W` by `H` pbuffer stands in for the window, so `scene_draw` can
+// blit to it as usual. Mesa's surfaceless platform needs no display server,
+// and falls back to `llvmpipe` when there's no GPU to render on.
+template <usize W, usize H>
+static EGLDisplay init_get_context() {
+    EGLDisplay display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                               EGL_DEFAULT_DISPLAY,
+                                               null);
+    EXIT_IF(display == EGL_NO_DISPLAY);
+    EXIT_IF(!eglInitialize(display, null, null));
+    const i32 attributes_config[] = {
+        EGL_SURFACE_TYPE,
+        EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE,
+        EGL_OPENGL_BIT,
+        EGL_RED_SIZE,
+        8,
+        EGL_GREEN_SIZE,
+        8,
+        EGL_BLUE_SIZE,
+        8,
+        EGL_DEPTH_SIZE,
+        24,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    i32       len_configs = 0;
+    EXIT_IF(!eglChooseConfig(display,
+                             attributes_config,
+                             &config,
+                             1,
+                             &len_configs) ||
+            (len_configs != 1));
+    const i32 attributes_surface[] = {
+        EGL_WIDTH,
+        static_cast<i32>(W),
+        EGL_HEIGHT,
+        static_cast<i32>(H),
+        EGL_NONE,
+    };
+    EGLSurface surface =
+        eglCreatePbufferSurface(display, config, attributes_surface);
+    EXIT_IF(surface == EGL_NO_SURFACE);
+    EXIT_IF(!eglBindAPI(EGL_OPENGL_API));
+    const i32 attributes_context[] = {
+        EGL_CONTEXT_MAJOR_VERSION,
+        3,
+        EGL_CONTEXT_MINOR_VERSION,
+        3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    EGLContext context =
+        eglCreateContext(display, config, EGL_NO_CONTEXT, attributes_context);
+    EXIT_IF(context == EGL_NO_CONTEXT);
+    EXIT_IF(!eglMakeCurrent(display, surface, surface, context));
+    return display;
+}
+
+#else
+
+struct Native {
+    Display* display;
+    Window   window;
+};
+
 static void init_hide_cursor(Native native) {
     XFixesHideCursor(native.display, native.window);
     XFlush(native.display);
@@ -58,10 +205,11 @@ static GLFWwindow* init_get_window(const char* name) {
     // visible. See `https://github.com/glfw/glfw/issues/1790`.
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetInputMode(window, GLFW_STICKY_KEYS, true);
-    glfwSwapInterval(1);
     return window;
 }
 
+#endif
+
 template <usize N>
 static u32 init_get_shader(BufferMemory<N>* memory,
                            const char*      source,
@@ -82,12 +230,8 @@ static u32 init_get_shader(BufferMemory<N>* memory,
 }
 
 template <usize N>
-static u32 init_get_program(BufferMemory<N>* memory,
-                            u32              vertex_shader,
-                            u32              fragment_shader) {
-    const u32 program = glCreateProgram();
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, fragment_shader);
+static void init_link_program(BufferMemory<N>* memory, u32 program) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, true);
     glLinkProgram(program);
     i32 status;
     glGetProgramiv(program, GL_LINK_STATUS, &status);
@@ -98,9 +242,202 @@ static u32 init_get_program(BufferMemory<N>* memory,
                             memory->buffer);
         EXIT_WITH(memory->buffer);
     }
+}
+
+template <usize N>
+static u32 init_get_program(BufferMemory<N>* memory,
+                            u32              vertex_shader,
+                            u32              fragment_shader) {
+    const u32 program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    init_link_program(memory, program);
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
     return program;
 }
 
+// NOTE: Vertex-only program whose single output is captured by transform
+// feedback; meant to be run with `GL_RASTERIZER_DISCARD` enabled.
+template <usize N>
+static u32 init_get_program_feedback(BufferMemory<N>* memory,
+                                     u32              vertex_shader,
+                                     const char*      varying) {
+    const u32 program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glTransformFeedbackVaryings(program, 1, &varying, GL_INTERLEAVED_ATTRIBS);
+    init_link_program(memory, program);
+    glDeleteShader(vertex_shader);
+    return program;
+}
+
+// NOTE: `FNV-1a`, terminator included, so `("ab", "c")` and `("a", "bc")`
+// hash differently.
+static u64 init_hash(u64 hash, const char* string) {
+    for (;;) {
+        hash = (hash ^ static_cast<u8>(*string)) * INIT_HASH_PRIME;
+        if (!*string++) {
+            return hash;
+        }
+    }
+}
+
+// NOTE: Needs a current context. Drivers that can't hand back a binary just
+// compile every time.
+static void init_set_cache() {
+    i32 formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    INIT_CACHE.enabled = 0 < formats;
+    INIT_CACHE.driver = INIT_HASH_OFFSET;
+    const u32 names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (u32 i = 0; i < (sizeof(names) / sizeof(names[0])); ++i) {
+        INIT_CACHE.driver = init_hash(
+            INIT_CACHE.driver,
+            reinterpret_cast<const char*>(glGetString(names[i])));
+    }
+    if (INIT_CACHE.enabled && mkdir(INIT_CACHE_PATH, 0755) &&
+        (errno != EEXIST))
+    {
+        fprintf(stderr, "program cache : can't create %s\n", INIT_CACHE_PATH);
+        INIT_CACHE.enabled = false;
+    }
+    CHECK_GL_ERROR();
+}
+
+static void init_set_cache_path(char* path, u64 key, const char* suffix) {
+    snprintf(path,
+             INIT_CAP_PATH,
+             INIT_CACHE_PATH "/%016" PRIx64 "%s",
+             key,
+             suffix);
+}
+
+// NOTE: Returns `0` for anything short of a program the driver accepted.
+static u32 init_get_program_binary(u64 key, Arena* arena) {
+    char path[INIT_CAP_PATH];
+    init_set_cache_path(path, key, "");
+    const i32 file = open(path, O_RDONLY);
+    if (file < 0) {
+        return 0;
+    }
+    struct stat info;
+    EXIT_IF(fstat(file, &info));
+    const usize size = static_cast<usize>(info.st_size);
+    if (size < sizeof(InitCacheHeader)) {
+        EXIT_IF(close(file));
+        return 0;
+    }
+    u8* data = static_cast<u8*>(arena_alloc(arena, size, alignof(u64)));
+    const bool read_all = read(file, data, size) == static_cast<i64>(size);
+    EXIT_IF(close(file));
+    const InitCacheHeader* header =
+        reinterpret_cast<const InitCacheHeader*>(data);
+    if ((!read_all) || (header->magic != INIT_CACHE_MAGIC) ||
+        (header->key != key) ||
+        (header->size != (size - sizeof(InitCacheHeader))))
+    {
+        return 0;
+    }
+    const u32 program = glCreateProgram();
+    glProgramBinary(program,
+                    header->format,
+                    data + sizeof(InitCacheHeader),
+                    static_cast<i32>(header->size));
+    // NOTE: A format the driver has since dropped is an error, not just a
+    // failed link; don't leave it for the next `CHECK_GL_ERROR`.
+    const bool error = glGetError() != GL_NO_ERROR;
+    i32        status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (error || !status) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// NOTE: Written next to its final path and renamed over it, so a crash
+// mid-write never leaves a torn entry behind. Failing to write is only worth
+// a warning.
+static void init_set_program_binary(u64 key, u32 program, Arena* arena) {
+    i32 size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) {
+        return;
+    }
+    InitCacheHeader header = {
+        INIT_CACHE_MAGIC,
+        0,
+        key,
+        static_cast<u64>(size),
+    };
+    void* data = arena_alloc(arena, static_cast<usize>(size), alignof(u64));
+    glGetProgramBinary(program, size, null, &header.format, data);
+    CHECK_GL_ERROR();
+    char path[INIT_CAP_PATH];
+    char path_temp[INIT_CAP_PATH];
+    init_set_cache_path(path, key, "");
+    init_set_cache_path(path_temp, key, ".tmp");
+    FILE* file = fopen(path_temp, "wb");
+    if (!file) {
+        fprintf(stderr, "program cache : can't write %s\n", path_temp);
+        return;
+    }
+    const bool written =
+        (fwrite(&header, sizeof(header), 1, file) == 1) &&
+        (fwrite(data, static_cast<usize>(size), 1, file) == 1);
+    if ((fclose(file) != 0) || (!written) || rename(path_temp, path)) {
+        fprintf(stderr, "program cache : can't write %s\n", path);
+    }
+}
+
+// NOTE: `fragment` of `null` builds a transform feedback program capturing
+// `varying`; see `init_get_program_feedback`. Scratch comes from `arena`,
+// which the caller resets.
+template <usize N>
+static u32 init_get_program_cached(BufferMemory<N>* memory,
+                                   Arena*           arena,
+                                   const char*      vertex,
+                                   const char*      fragment,
+                                   const char*      varying) {
+    u64 key = init_hash(INIT_CACHE.driver, vertex);
+    key = init_hash(key, fragment ? fragment : "");
+    key = init_hash(key, varying ? varying : "");
+    if (INIT_CACHE.enabled) {
+        const u32 program = init_get_program_binary(key, arena);
+        if (program) {
+            ++INIT_CACHE.hits;
+            return program;
+        }
+    }
+    ++INIT_CACHE.misses;
+    const u32 program =
+        fragment
+            ? init_get_program(
+                  memory,
+                  init_get_shader(memory, vertex, GL_VERTEX_SHADER),
+                  init_get_shader(memory, fragment, GL_FRAGMENT_SHADER))
+            : init_get_program_feedback(
+                  memory,
+                  init_get_shader(memory, vertex, GL_VERTEX_SHADER),
+                  varying);
+    if (INIT_CACHE.enabled) {
+        init_set_program_binary(key, program, arena);
+    }
+    return program;
+}
+
+// NOTE: Uniform blocks are bound by hand, since GLSL `330` can't say which
+// binding a block lives on, and neither linking nor loading a binary keeps a
+// previous choice. `FRAME` is the per-frame block (see `SceneFrame`).
+#define INIT_BINDING_FRAME 0
+
+static void init_set_uniform_block(u32         program,
+                                   const char* name,
+                                   u32         binding) {
+    const u32 index = glGetUniformBlockIndex(program, name);
+    EXIT_IF(index == GL_INVALID_INDEX);
+    glUniformBlockBinding(program, index, binding);
+    CHECK_GL_ERROR();
+}
+
 #endif
@@ -0,0 +1,136 @@
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include "player.hpp"
+#include "triple.hpp"
+
+// NOTE: Input reaches the simulation as a queue of timestamped events rather
+// than a sampled snapshot. Events are stamped as GLFW delivers them, and the
+// render thread waits on the event queue instead of sleeping (see
+// `wait_events`), so most arrive well inside a frame. Each tick applies
+// every event stamped at or before its own start. Exactly one writer (the
+// render thread, which owns GLFW) and one reader (the simulation thread).
+#define INPUT_CAP_EVENTS (1lu << 10)
+
+#define INPUT_EVENT_KEY_DOWN 0
+#define INPUT_EVENT_KEY_UP   1
+#define INPUT_EVENT_LOOK     2
+
+struct InputEvent {
+    Vec3 view_target;
+    u64  time;
+    u8   type;
+    u8   key;
+};
+
+// NOTE: `held`, `pushed` and `dropped` belong to the writer, `keys` to the
+// reader. `held` is what the keyboard says is down, `pushed` what the queue
+// has been told; they differ while an event is dropped.
+struct InputQueue {
+    InputEvent              events[INPUT_CAP_EVENTS];
+    alignas(CACHE_LINE) u64 head;
+    u64                     dropped;
+    u8                      held;
+    u8                      pushed;
+    alignas(CACHE_LINE) u64 tail;
+    u8                      keys;
+};
+
+static InputQueue INPUT_QUEUE;
+
+static void input_reset(InputQueue* queue) {
+    queue->head = 0;
+    queue->dropped = 0;
+    queue->held = 0;
+    queue->pushed = 0;
+    queue->tail = 0;
+    queue->keys = 0;
+}
+
+// NOTE: The queue only fills if the simulation stalls for
+// `INPUT_CAP_EVENTS` events, in which case the event is dropped and counted.
+// Returns whether it was queued.
+static bool input_push(InputQueue* queue, InputEvent event) {
+    const u64 head = queue->head;
+    if ((head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)) ==
+        INPUT_CAP_EVENTS)
+    {
+        ++queue->dropped;
+        return false;
+    }
+    queue->events[head % INPUT_CAP_EVENTS] = event;
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// NOTE: Pushes one event per key that differs from what was last pushed, so
+// callers can hand over whole key sets and never repeat a press. `pushed`
+// only takes keys whose event was queued, so a dropped one goes out again
+// with the next key set.
+static void input_push_keys(InputQueue* queue, u64 time, u8 keys) {
+    for (u8 key = INPUT_KEY_W; key <= INPUT_KEY_SPACE;
+         key = static_cast<u8>(key << 1))
+    {
+        if (!((keys ^ queue->pushed) & key)) {
+            continue;
+        }
+        const InputEvent event = {
+            {},
+            time,
+            (keys & key) ? static_cast<u8>(INPUT_EVENT_KEY_DOWN)
+                         : static_cast<u8>(INPUT_EVENT_KEY_UP),
+            key,
+        };
+        if (input_push(queue, event)) {
+            queue->pushed ^= key;
+        }
+    }
+}
+
+// NOTE: For writers that learn about one key at a time, like GLFW's key
+// callback. The new key set is built from `held`, never from `pushed`, so a
+// key whose press was dropped stays down; pushing `held` again each frame
+// resends it even if no other key changes.
+static void input_push_key(InputQueue* queue, u64 time, u8 key, bool down) {
+    queue->held = down ? static_cast<u8>(queue->held | key)
+                       : static_cast<u8>(queue->held & ~key);
+    input_push_keys(queue, time, queue->held);
+}
+
+static void input_push_look(InputQueue* queue, u64 time, Vec3 view_target) {
+    const InputEvent event = {
+        view_target,
+        time,
+        INPUT_EVENT_LOOK,
+        0,
+    };
+    input_push(queue, event);
+}
+
+// NOTE: Simulation thread, once per tick. A key pressed and released between
+// two ticks still counts as held for one, so taps shorter than a tick aren't
+// lost. `input->time` is the stamp of the newest event applied.
+static void input_pop(InputQueue* queue, u64 time, Input* input) {
+    const u64 head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    u64       tail = queue->tail;
+    u8        pressed = 0;
+    for (; tail < head; ++tail) {
+        const InputEvent* event = &queue->events[tail % INPUT_CAP_EVENTS];
+        if (time < event->time) {
+            break;
+        }
+        if (event->type == INPUT_EVENT_KEY_DOWN) {
+            queue->keys |= event->key;
+            pressed |= event->key;
+        } else if (event->type == INPUT_EVENT_KEY_UP) {
+            queue->keys &= static_cast<u8>(~event->key);
+        } else {
+            input->view_target = event->view_target;
+        }
+        input->time = event->time;
+    }
+    __atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+    input->keys = queue->keys | pressed;
+}
+
+#endif
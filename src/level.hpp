@@ -0,0 +1,534 @@
+#ifndef __LEVEL_H__
+#define __LEVEL_H__
+
+#include "reach.hpp"
+#include "scene_assets.hpp"
+#include "spatial_hash.hpp"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// NOTE: Binary level file, written by `bin/codegen` and `mmap`ed as-is. Each
+// section starts on a `LEVEL_ALIGN` boundary and holds records in exactly the
+// layout GL and the broadphase consume, so loading is validation plus
+// pointer arithmetic. Bump `LEVEL_VERSION` whenever `LevelHeader`,
+// `Instance`, `Cube`, `LevelChunk`, or `ReachEdge` change shape; the
+// recorded sizes only catch some of that.
+#define LEVEL_MAGIC   0x6C706D6A
+#define LEVEL_VERSION 5
+#define LEVEL_ALIGN   64
+
+// NOTE: Platforms are stored grouped by the `LEVEL_CHUNK` by `LEVEL_CHUNK`
+// column (in `x` and `z`) their centre falls in, so any chunk can be read
+// with two contiguous reads; see `stream.hpp`.
+#define LEVEL_CHUNK 64.0f
+
+#define LEVEL_PATH "bin/platforms.level"
+
+// NOTE: Set in `LevelHeader::flags` when every instance only translates and
+// scales, so the `SCALED` shader variant draws it correctly.
+#define LEVEL_SCALED 1
+
+// NOTE: `offset_grid` is `0` when the file carries no prebuilt grid.
+// Otherwise it points at a `LevelGrid`, followed directly by its
+// `GRID_CELLS + 1` offsets and then its `len_indices` indices.
+struct LevelGrid {
+    Cube bounds;
+    Vec3 span;
+    u32  cells;
+    u32  len_indices;
+};
+
+// NOTE: `offset_reach` is `0` when the file carries no reachability graph.
+// Otherwise it points at a `LevelReach`, followed directly by its
+// `len_platforms + 1` offsets and then its `len_edges` edges; see
+// `reach.hpp`.
+struct LevelReach {
+    u32 len_platforms;
+    u32 len_edges;
+};
+
+// NOTE: Chunks are sorted by `x`, then `z`. A chunk holds platforms
+// `first` through `first + len - 1`, and `bounds` covers all of them, which
+// may reach past the chunk itself by up to `LevelHeader::chunk_extent`.
+struct LevelChunk {
+    Cube bounds;
+    i32  x;
+    i32  z;
+    u32  first;
+    u32  len;
+};
+
+// NOTE: `flags` holds `LEVEL_*` bits; `pad` spells out what would otherwise
+// be padding, so every byte written is set.
+struct LevelHeader {
+    u32 magic;
+    u32 version;
+    u32 size_header;
+    u32 size_instance;
+    u32 size_cube;
+    u32 size_chunk;
+    u32 size_reach_edge;
+    u32 len_platforms;
+    u32 len_chunks;
+    u32 len_chunk_max;
+    f32 chunk_size;
+    f32 chunk_extent;
+    u32 flags;
+    u32 pad;
+    u64 offset_instances;
+    u64 offset_platforms;
+    u64 offset_chunks;
+    u64 offset_grid;
+    u64 offset_reach;
+    u64 size;
+};
+
+// NOTE: `file` stays open only for levels opened to be streamed.
+struct Level {
+    const LevelHeader* header;
+    const Instance*    instances;
+    const Cube*        platforms;
+    const LevelChunk*  chunks;
+    const LevelGrid*   grid;
+    const u32*         grid_offsets;
+    const u32*         grid_indices;
+    Reach              reach;
+    u32                len_platforms;
+    u32                len_chunks;
+    i32                file;
+};
+
+static Level LEVEL;
+
+static u64 level_align(u64 offset) {
+    return (offset + (LEVEL_ALIGN - 1)) & ~(LEVEL_ALIGN - 1lu);
+}
+
+static u64 level_get_size_grid(u32 len_indices) {
+    return sizeof(LevelGrid) + (sizeof(u32) * (GRID_CELLS + 1)) +
+           (sizeof(u32) * len_indices);
+}
+
+static u64 level_get_size_reach(u32 len_platforms, u32 len_edges) {
+    return sizeof(LevelReach) + (sizeof(u32) * (len_platforms + 1)) +
+           (sizeof(ReachEdge) * len_edges);
+}
+
+static i32 level_get_chunk(f32 x, f32 size) {
+    return static_cast<i32>(floorf(x / size));
+}
+
+// NOTE: `len_grid_indices` of `0` leaves the grid out, as does a `null`
+// `reach` the reachability graph.
+static LevelHeader level_get_header(u32          len_platforms,
+                                    u32          len_chunks,
+                                    u32          len_grid_indices,
+                                    const Reach* reach) {
+    LevelHeader header = {};
+    header.magic = LEVEL_MAGIC;
+    header.version = LEVEL_VERSION;
+    header.size_header = sizeof(LevelHeader);
+    header.size_instance = sizeof(Instance);
+    header.size_cube = sizeof(Cube);
+    header.size_chunk = sizeof(LevelChunk);
+    header.size_reach_edge = sizeof(ReachEdge);
+    header.len_platforms = len_platforms;
+    header.len_chunks = len_chunks;
+    header.chunk_size = LEVEL_CHUNK;
+    header.offset_instances = level_align(sizeof(LevelHeader));
+    header.offset_platforms = level_align(header.offset_instances +
+                                          (sizeof(Instance) * len_platforms));
+    header.offset_chunks =
+        level_align(header.offset_platforms + (sizeof(Cube) * len_platforms));
+    header.size = level_align(header.offset_chunks +
+                              (sizeof(LevelChunk) * len_chunks));
+    if (len_grid_indices) {
+        header.offset_grid = header.size;
+        header.size = level_align(header.offset_grid +
+                                  level_get_size_grid(len_grid_indices));
+    }
+    if (reach) {
+        header.offset_reach = header.size;
+        header.size = level_align(
+            header.offset_reach +
+            level_get_size_reach(reach->len_platforms, reach->len_edges));
+    }
+    return header;
+}
+
+template <typename T>
+static const T* level_get_section(u64 offset, u64 size) {
+    EXIT_IF(offset % LEVEL_ALIGN);
+    EXIT_IF((LEVEL.header->size < offset) ||
+            ((LEVEL.header->size - offset) < size));
+    return static_cast<const T*>(static_cast<const void*>(
+        reinterpret_cast<const u8*>(LEVEL.header) + offset));
+}
+
+// NOTE: A level opened with `stream` is mapped without being read in; only
+// the pages of the chunk table that lookups touch are ever faulted in, and
+// `stream.hpp` reads chunks through `LEVEL.file` as they are needed.
+static void level_open(const char* path, bool stream) {
+    const i32 file = open(path, O_RDONLY);
+    if (file < 0) {
+        EXIT_WITH(path);
+    }
+    struct stat info;
+    EXIT_IF(fstat(file, &info));
+    const usize size = static_cast<usize>(info.st_size);
+    EXIT_IF(size < sizeof(LevelHeader));
+    void* address = mmap(null,
+                         size,
+                         PROT_READ,
+                         stream ? MAP_PRIVATE : MAP_PRIVATE | MAP_POPULATE,
+                         file,
+                         0);
+    EXIT_IF(address == MAP_FAILED);
+    if (stream) {
+        LEVEL.file = file;
+    } else {
+        LEVEL.file = -1;
+        EXIT_IF(close(file));
+    }
+    LEVEL.header = static_cast<const LevelHeader*>(address);
+    EXIT_IF(LEVEL.header->magic != LEVEL_MAGIC);
+    EXIT_IF(LEVEL.header->version != LEVEL_VERSION);
+    EXIT_IF(LEVEL.header->size_header != sizeof(LevelHeader));
+    EXIT_IF(LEVEL.header->size_instance != sizeof(Instance));
+    EXIT_IF(LEVEL.header->size_cube != sizeof(Cube));
+    EXIT_IF(LEVEL.header->size_chunk != sizeof(LevelChunk));
+    EXIT_IF(LEVEL.header->size_reach_edge != sizeof(ReachEdge));
+    EXIT_IF(LEVEL.header->size != size);
+    EXIT_IF(LEVEL.header->len_platforms == 0);
+    EXIT_IF(LEVEL.header->len_chunks == 0);
+    EXIT_IF(LEVEL.header->len_platforms < LEVEL.header->len_chunk_max);
+    EXIT_IF(!(0.0f < LEVEL.header->chunk_size));
+    EXIT_IF(!(0.0f <= LEVEL.header->chunk_extent));
+    LEVEL.len_platforms = LEVEL.header->len_platforms;
+    LEVEL.len_chunks = LEVEL.header->len_chunks;
+    LEVEL.instances = level_get_section<Instance>(
+        LEVEL.header->offset_instances,
+        sizeof(Instance) * LEVEL.len_platforms);
+    LEVEL.platforms =
+        level_get_section<Cube>(LEVEL.header->offset_platforms,
+                                sizeof(Cube) * LEVEL.len_platforms);
+    LEVEL.chunks =
+        level_get_section<LevelChunk>(LEVEL.header->offset_chunks,
+                                      sizeof(LevelChunk) * LEVEL.len_chunks);
+    if (LEVEL.header->offset_reach) {
+        const LevelReach* reach = level_get_section<LevelReach>(
+            LEVEL.header->offset_reach,
+            sizeof(LevelReach));
+        EXIT_IF(reach->len_platforms != LEVEL.len_platforms);
+        const u8* section = level_get_section<u8>(
+            LEVEL.header->offset_reach,
+            level_get_size_reach(reach->len_platforms, reach->len_edges));
+        LEVEL.reach.offsets = static_cast<const u32*>(
+            static_cast<const void*>(section + sizeof(LevelReach)));
+        LEVEL.reach.edges = static_cast<const ReachEdge*>(
+            static_cast<const void*>(LEVEL.reach.offsets +
+                                     reach->len_platforms + 1));
+        LEVEL.reach.len_platforms = reach->len_platforms;
+        LEVEL.reach.len_edges = reach->len_edges;
+        EXIT_IF(LEVEL.reach.offsets[LEVEL.reach.len_platforms] !=
+                LEVEL.reach.len_edges);
+    }
+    if (!LEVEL.header->offset_grid) {
+        return;
+    }
+    LEVEL.grid = level_get_section<LevelGrid>(LEVEL.header->offset_grid,
+                                              sizeof(LevelGrid));
+    EXIT_IF(LEVEL.grid->cells != GRID_CELLS);
+    const u8* grid =
+        level_get_section<u8>(LEVEL.header->offset_grid,
+                              level_get_size_grid(LEVEL.grid->len_indices));
+    LEVEL.grid_offsets = static_cast<const u32*>(
+        static_cast<const void*>(grid + sizeof(LevelGrid)));
+    LEVEL.grid_indices = LEVEL.grid_offsets + GRID_CELLS + 1;
+    EXIT_IF(LEVEL.grid_offsets[GRID_CELLS] != LEVEL.grid->len_indices);
+}
+
+// NOTE: Points the broadphase at the mapped table when the level has one,
+// otherwise builds it into `arena`.
+static void level_set_grid(GridMemory* memory, Arena* arena) {
+    if (!LEVEL.grid) {
+        hash_set(memory, arena, LEVEL.platforms, LEVEL.len_platforms);
+        return;
+    }
+    memory->bounds = LEVEL.grid->bounds;
+    memory->span = LEVEL.grid->span;
+    memory->cubes = LEVEL.platforms;
+    memory->len_cubes = LEVEL.len_platforms;
+    memory->offsets = LEVEL.grid_offsets;
+    memory->indices = LEVEL.grid_indices;
+    memory->len_indices = LEVEL.grid->len_indices;
+    hash_set_intersects_buffer(memory, arena);
+}
+
+// NOTE: Points at the mapped graph when the level has one, otherwise builds
+// it into `arena` against `memory`, which must already be set from this
+// level (see `level_set_grid`). Building is seconds for thousands of
+// platforms and much longer past that, so levels meant to be played should
+// carry one.
+static void level_set_reach(Reach*            reach,
+                            const GridMemory* memory,
+                            Arena*            arena) {
+    if (LEVEL.reach.offsets) {
+        *reach = LEVEL.reach;
+        return;
+    }
+    *reach = reach_get(memory, arena);
+}
+
+// NOTE: Binary search; returns `LEVEL.len_chunks` when the level has
+// nothing at `(x, z)`.
+static u32 level_find_chunk(i32 x, i32 z) {
+    u32 l = 0;
+    u32 r = LEVEL.len_chunks;
+    while (l < r) {
+        const u32         m = l + ((r - l) / 2);
+        const LevelChunk* chunk = &LEVEL.chunks[m];
+        if ((chunk->x < x) || ((chunk->x == x) && (chunk->z < z))) {
+            l = m + 1;
+        } else {
+            r = m;
+        }
+    }
+    if ((l < LEVEL.len_chunks) && (LEVEL.chunks[l].x == x) &&
+        (LEVEL.chunks[l].z == z))
+    {
+        return l;
+    }
+    return LEVEL.len_chunks;
+}
+
+static void level_close() {
+    EXIT_IF(
+        munmap(const_cast<LevelHeader*>(LEVEL.header), LEVEL.header->size));
+    if (0 <= LEVEL.file) {
+        EXIT_IF(close(LEVEL.file));
+    }
+    LEVEL = {};
+}
+
+// NOTE: Everything below is for exporters (`bin/codegen`, `bin/generate`).
+
+static Cube level_get_cube(Mat4 matrix) {
+    const f32 width_half = matrix.cell[0][0] / 2.0f;
+    const f32 height_half = matrix.cell[1][1] / 2.0f;
+    const f32 depth_half = matrix.cell[2][2] / 2.0f;
+    return {
+        {
+            matrix.cell[3][0] - width_half,
+            matrix.cell[3][1] - height_half,
+            matrix.cell[3][2] - depth_half,
+        },
+        {
+            matrix.cell[3][0] + width_half,
+            matrix.cell[3][1] + height_half,
+            matrix.cell[3][2] + depth_half,
+        },
+    };
+}
+
+// NOTE: `matrix` may only translate and scale; the bounds are read straight
+// off its diagonal.
+static void level_set_platform(Instance* instance,
+                               Cube*     platform,
+                               Mat4      matrix,
+                               u32       index) {
+    instance->matrix = matrix;
+    instance->color = {
+        cosf(static_cast<f32>(index * 2)),
+        sinf(static_cast<f32>(index * 3)),
+        (sinf(static_cast<f32>(index * 5)) +
+         cosf(static_cast<f32>(index * 7))) /
+            2.0f,
+    };
+    instance->color *= instance->color;
+    *platform = level_get_cube(matrix);
+}
+
+// NOTE: Only the upper left `3` by `3` is checked; nothing writes anything
+// but `0 0 0 1` along the bottom row.
+static bool level_is_scaled(const Instance* instances, u32 len_platforms) {
+    for (u32 i = 0; i < len_platforms; ++i) {
+        const Mat4* matrix = &instances[i].matrix;
+        for (u32 j = 0; j < 3; ++j) {
+            for (u32 k = 0; k < 3; ++k) {
+                if ((j != k) && ((matrix->cell[j][k] < 0.0f) ||
+                                 (0.0f < matrix->cell[j][k])))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static void level_write_section(FILE* file, const void* data, usize size) {
+    EXIT_IF(fwrite(data, 1, size, file) != size);
+}
+
+static void level_write_padding(FILE* file) {
+    static const u8 ZEROS[LEVEL_ALIGN] = {};
+    const u64       offset = static_cast<u64>(ftell(file));
+    const usize     padding = level_align(offset) - offset;
+    EXIT_IF(fwrite(ZEROS, 1, padding, file) != padding);
+}
+
+static void level_write_offset(FILE* file, u64 offset) {
+    EXIT_IF(static_cast<u64>(ftell(file)) != offset);
+}
+
+struct LevelKey {
+    i32 x;
+    i32 z;
+    u32 index;
+};
+
+// NOTE: Ties fall back to `index` so the order within a chunk is the order
+// platforms were given in, whatever `qsort` does with equal keys.
+static i32 level_compare_keys(const void* l, const void* r) {
+    const LevelKey* key_l = static_cast<const LevelKey*>(l);
+    const LevelKey* key_r = static_cast<const LevelKey*>(r);
+    if (key_l->x != key_r->x) {
+        return key_l->x < key_r->x ? -1 : 1;
+    }
+    if (key_l->z != key_r->z) {
+        return key_l->z < key_r->z ? -1 : 1;
+    }
+    if (key_l->index != key_r->index) {
+        return key_l->index < key_r->index ? -1 : 1;
+    }
+    return 0;
+}
+
+// NOTE: Sorts platforms by chunk into `sorted` and fills `chunks`, which
+// must have room for one chunk per platform; returns how many were used.
+static u32 level_set_chunks(LevelHeader*    header,
+                            const Cube*     platforms,
+                            const LevelKey* keys,
+                            Cube*           sorted,
+                            LevelChunk*     chunks) {
+    u32 len_chunks = 0;
+    for (u32 i = 0; i < header->len_platforms; ++i) {
+        const LevelKey* key = &keys[i];
+        const Cube*     platform = &platforms[key->index];
+        sorted[i] = *platform;
+        if ((i == 0) || (key->x != keys[i - 1].x) || (key->z != keys[i - 1].z))
+        {
+            chunks[len_chunks++] = {*platform, key->x, key->z, i, 0};
+        }
+        LevelChunk* chunk = &chunks[len_chunks - 1];
+        chunk->bounds.bottom_left_front =
+            min(chunk->bounds.bottom_left_front, platform->bottom_left_front);
+        chunk->bounds.top_right_back =
+            max(chunk->bounds.top_right_back, platform->top_right_back);
+        ++chunk->len;
+        header->len_chunk_max = MAX(header->len_chunk_max, chunk->len);
+        const f32 x = static_cast<f32>(key->x) * LEVEL_CHUNK;
+        const f32 z = static_cast<f32>(key->z) * LEVEL_CHUNK;
+        header->chunk_extent =
+            MAX(header->chunk_extent,
+                MAX(MAX(x - platform->bottom_left_front.x,
+                        platform->top_right_back.x - (x + LEVEL_CHUNK)),
+                    MAX(z - platform->bottom_left_front.z,
+                        platform->top_right_back.z - (z + LEVEL_CHUNK))));
+    }
+    return len_chunks;
+}
+
+// NOTE: The grid, and the reachability graph when `reach` is set, are baked
+// by the same code that would otherwise build them at runtime, so the two
+// can't drift apart. They, the chunk table, and the sorted copies are all
+// built in `arena`.
+static void level_write(const char*     path,
+                        const Instance* instances,
+                        const Cube*     platforms,
+                        u32             len_platforms,
+                        bool            reach,
+                        Arena*          arena) {
+    LevelKey* keys = arena_alloc<LevelKey>(arena, len_platforms);
+    for (u32 i = 0; i < len_platforms; ++i) {
+        const Vec3 center =
+            (platforms[i].bottom_left_front + platforms[i].top_right_back) /
+            2.0f;
+        keys[i] = {
+            level_get_chunk(center.x, LEVEL_CHUNK),
+            level_get_chunk(center.z, LEVEL_CHUNK),
+            i,
+        };
+    }
+    qsort(keys, len_platforms, sizeof(LevelKey), level_compare_keys);
+    LevelHeader header = {};
+    header.len_platforms = len_platforms;
+    Cube*       sorted = arena_alloc<Cube>(arena, len_platforms);
+    LevelChunk* chunks = arena_alloc<LevelChunk>(arena, len_platforms);
+    const u32   len_chunks =
+        level_set_chunks(&header, platforms, keys, sorted, chunks);
+    GridMemory grid = {};
+    hash_set(&grid, arena, sorted, len_platforms);
+    const Reach graph = reach ? reach_get(&grid, arena) : Reach{};
+    {
+        const u32 len_chunk_max = header.len_chunk_max;
+        const f32 chunk_extent = header.chunk_extent;
+        header = level_get_header(len_platforms,
+                                  len_chunks,
+                                  grid.len_indices,
+                                  reach ? &graph : null);
+        header.len_chunk_max = len_chunk_max;
+        header.chunk_extent = chunk_extent;
+    }
+    if (level_is_scaled(instances, len_platforms)) {
+        header.flags |= LEVEL_SCALED;
+    }
+    const LevelGrid level_grid = {
+        grid.bounds,
+        grid.span,
+        GRID_CELLS,
+        grid.len_indices,
+    };
+    FILE* file = fopen(path, "wb");
+    EXIT_IF(!file);
+    level_write_section(file, &header, sizeof(header));
+    level_write_padding(file);
+    level_write_offset(file, header.offset_instances);
+    for (u32 i = 0; i < len_platforms; ++i) {
+        level_write_section(file,
+                            &instances[keys[i].index],
+                            sizeof(Instance));
+    }
+    level_write_padding(file);
+    level_write_offset(file, header.offset_platforms);
+    level_write_section(file, sorted, sizeof(Cube) * len_platforms);
+    level_write_padding(file);
+    level_write_offset(file, header.offset_chunks);
+    level_write_section(file, chunks, sizeof(LevelChunk) * len_chunks);
+    level_write_padding(file);
+    level_write_offset(file, header.offset_grid);
+    level_write_section(file, &level_grid, sizeof(level_grid));
+    level_write_section(file, grid.offsets, sizeof(u32) * (GRID_CELLS + 1));
+    level_write_section(file, grid.indices, sizeof(u32) * grid.len_indices);
+    level_write_padding(file);
+    if (reach) {
+        const LevelReach level_reach = {graph.len_platforms, graph.len_edges};
+        level_write_offset(file, header.offset_reach);
+        level_write_section(file, &level_reach, sizeof(level_reach));
+        level_write_section(file,
+                            graph.offsets,
+                            sizeof(u32) * (graph.len_platforms + 1));
+        level_write_section(file,
+                            graph.edges,
+                            sizeof(ReachEdge) * graph.len_edges);
+        level_write_padding(file);
+    }
+    level_write_offset(file, header.size);
+    EXIT_IF(fclose(file));
+}
+
+#endif
@@ -1,11 +1,24 @@
+#include "arena.hpp"
+#include "capture.hpp"
+#include "histogram.hpp"
 #include "init_assets_codegen.hpp"
+#include "input.hpp"
+#include "level.hpp"
+#include "metrics.hpp"
+#include "pacing.hpp"
+#include "player.hpp"
+#include "resolution.hpp"
 #include "scene.hpp"
 #include "spatial_hash.hpp"
+#include "stream.hpp"
+#include "triple.hpp"
 
-#include <sys/mman.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define CAP_CHARS (1 << 10)
-#define CAP_LISTS (1 << 7)
 
 #define INIT_WINDOW_WIDTH  (1 << 10)
 #define INIT_WINDOW_HEIGHT ((1 << 9) + (1 << 8))
@@ -13,76 +26,104 @@
 static i32 WINDOW_WIDTH = INIT_WINDOW_WIDTH;
 static i32 WINDOW_HEIGHT = INIT_WINDOW_HEIGHT;
 
-#define FRAME_BUFFER_SCALE 4
+// NOTE: `--train <frames>` replaces the keyboard and mouse with
+// `get_scripted_input`, drops pacing, and exits after that many frames with a
+// throughput report. It is the workload `scripts/release.sh` profiles. The
+// two threads run in lockstep, `FRAME_UPDATE_COUNT` ticks to a frame, so
+// every run does the same work per frame; whichever side is ahead sleeps in
+// `TRAIN_POLL` steps rather than spinning.
+static u64 TRAIN_FRAMES = 0;
+
+#define TRAIN_POLL (NANOSECONDS / 20000lu)
+
+// NOTE: `--latency` records, for every frame that picked up new input, the
+// time from the newest event its state applied to the swap returning, and
+// prints percentiles on exit.
+static bool LATENCY = false;
+
+// NOTE: Finest scale the resolution controller will use; it only coarsens
+// past this when the GPU can't keep up, up to `FRAME_BUFFER_SCALE_MAX`.
+#define FRAME_BUFFER_SCALE     4
+#define FRAME_BUFFER_SCALE_MAX (FRAME_BUFFER_SCALE * 4)
 
 #define FRAME_BUFFER_WIDTH  (INIT_WINDOW_WIDTH / FRAME_BUFFER_SCALE)
 #define FRAME_BUFFER_HEIGHT (INIT_WINDOW_HEIGHT / FRAME_BUFFER_SCALE)
 
-struct Uniform {
-    i32 time;
-    i32 position;
-    i32 projection;
-    i32 view;
+// NOTE: Only rebuilt when the window changes shape.
+struct Projection {
+    Mat4 matrix;
+    i32  width;
+    i32  height;
 };
 
-struct Player {
-    Vec3 position;
-    Vec3 speed;
-    bool can_jump;
-    bool jump_key_released;
-};
+static Projection PROJECTION;
 
 struct State {
-    Player player;
-    f32    time;
+    Player           player;
+    u64              time;
+    u64              input_time;
+    HistogramSummary tick;
+    HistogramSummary sleep;
+    u64              ticks;
+    u64              tick_time;
+    u64              hash_queries;
+    u64              hash_candidates;
+    u32              window;
 };
 
 struct Frame {
-    f32 time;
-    f32 prev;
-    f32 delta;
-    f32 debug_time;
-    u8  debug_count;
+    HistogramRolling histogram;
+    Histogram        input;
+    HistogramSummary summary;
+    FILE*            log;
+    u64              time;
+    u64              interval;
+    u64              window_time;
+    u64              input_time;
+    f32              latency;
+    u32              window;
 };
 
-struct Memory {
-    BufferMemory<CAP_CHARS>                buffer;
-    GridMemory<CAP_LISTS, COUNT_PLATFORMS> grid;
+// NOTE: Shared between the render thread (`loop`) and the simulation thread
+// (`simulate`); only `state`, `running`, and `INPUT_QUEUE` are touched by
+// both. `input` and the histograms belong to the simulation thread, which
+// publishes the histograms' summaries through `State` once per window.
+struct Simulation {
+    GridMemory*      memory;
+    Input            input;
+    Triple<State>    state;
+    HistogramRolling tick;
+    HistogramRolling sleep;
+    u64              step;
+    u64              budget;
+    bool             running;
 };
 
-#define RUN      0.00325f
-#define FRICTION 0.96f
-#define DRAG     0.99f
-
-#define SPEED_MAX         0.125f
-#define SPEED_EPSILON     0.0001f
-#define SPEED_MAX_SQUARED (SPEED_MAX * SPEED_MAX)
-
-#define WORLD_Y_MIN -20.0f
-
-#define JUMP    0.0585f
-#define GRAVITY 0.000345f
-
-#define INIT_PLAYER_POSITION \
-    ((Vec3){                 \
-        -7.5f,               \
-        35.0f,               \
-        17.5f,               \
-    })
+// NOTE: Lives in `ARENAS.permanent`; the grid's lists live in `ARENAS.level`.
+struct Memory {
+    BufferMemory<CAP_CHARS> buffer;
+    GridMemory              grid;
+    Simulation              simulation;
+};
 
-#define PLAYER_WIDTH  1.5f
-#define PLAYER_HEIGHT 4.0f
-#define PLAYER_DEPTH  1.5f
+// NOTE: Handed to `load_level`, which runs on its own thread while the
+// window, context, and programs are created on the main one.
+struct Load {
+    GridMemory* grid;
+    const char* path;
+    u64         time;
+    bool        stream;
+};
 
-#define PLAYER_WIDTH_HALF (PLAYER_WIDTH / 2.0f)
-#define PLAYER_DEPTH_HALF (PLAYER_DEPTH / 2.0f)
+// NOTE: Nanoseconds; `start` is on entering `main`, `first_frame` when the
+// first swap returns.
+struct Startup {
+    u64 start;
+    u64 programs;
+    u64 first_frame;
+};
 
-#define VIEW_UP                                     \
-    ((Vec3){                                        \
-        0.0f, /* NOTE: `x`-axis is left/right.   */ \
-        1.0f, /* NOTE: `y`-axis is down/up.      */ \
-        0.0f, /* NOTE: `z`-axis is forward/back. */ \
-    })
+static Startup STARTUP;
 
 static Vec3 VIEW_TARGET;
 
@@ -109,51 +150,82 @@ static f32 VIEW_PITCH = 0.0f;
 
 #define PITCH_LIMIT 89.0f
 
-#define MICROSECONDS 1000000.0f
-#define MILLISECONDS 1000.0f
-
-#define FRAME_UPDATE_COUNT 8.0f
-#define FRAME_DURATION     ((1.0f / 60.0f) * MICROSECONDS)
-#define FRAME_UPDATE_STEP  (FRAME_DURATION / FRAME_UPDATE_COUNT)
-
-#define NORM_CROSS(a, b) norm(cross(a, b))
-
-static void set_input(GLFWwindow* window, State* state) {
-    glfwPollEvents();
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, true);
-    }
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-        state->player.speed -=
-            NORM_CROSS(cross(VIEW_TARGET, VIEW_UP), VIEW_UP) * RUN;
-    }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-        state->player.speed += NORM_CROSS(VIEW_TARGET, VIEW_UP) * RUN;
-    }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-        state->player.speed +=
-            NORM_CROSS(cross(VIEW_TARGET, VIEW_UP), VIEW_UP) * RUN;
-    }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-        state->player.speed -= NORM_CROSS(VIEW_TARGET, VIEW_UP) * RUN;
+#define MICROSECONDS_PER_MILLISECOND 1000.0f
+
+// NOTE: Default render rate; `--rate` overrides it. The simulation always
+// ticks at `FRAME_RATE * FRAME_UPDATE_COUNT`, since the movement constants
+// are tuned per tick.
+#define FRAME_RATE         60lu
+#define FRAME_UPDATE_COUNT 8lu
+#define FRAME_UPDATE_STEP  (NANOSECONDS / (FRAME_RATE * FRAME_UPDATE_COUNT))
+
+// NOTE: If the simulation falls this far behind it skips ahead rather than
+// spiralling through a backlog of ticks.
+#define FRAME_UPDATE_BACKLOG (NANOSECONDS / FRAME_RATE)
+
+#define JITTER_SMOOTHING 0.01f
+
+// NOTE: Both threads summarize their histograms this often, each summary
+// covering the last `HISTOGRAM_SLICES` windows.
+#define TELEMETRY_WINDOW NANOSECONDS
+
+// NOTE: Waits out the frame on the window system's event queue rather than
+// sleeping, so events are stamped as they arrive instead of when the next
+// frame starts. The last `PACING_SPIN` is left to `pacing_begin`.
+static void wait_events() {
+    TRACE_SCOPE("wait_events");
+    for (;;) {
+        const u64 now = pacing_now();
+        if ((!PACING.period) || (PACING.deadline < (now + PACING_SPIN))) {
+            break;
+        }
+        glfwWaitEventsTimeout(
+            static_cast<f64>(PACING.deadline - PACING_SPIN - now) /
+            NANOSECONDS);
     }
-    if ((glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) &&
-        (state->player.can_jump))
-    {
-        state->player.speed.y += JUMP;
-        state->player.can_jump = false;
-        state->player.jump_key_released = false;
+    glfwPollEvents();
+}
+
+// NOTE: Mouse movement piles up in `CURSOR_X_DELTA` and `CURSOR_Y_DELTA` and
+// is turned into a view direction here, once per frame, rather than on every
+// event.
+static void set_look() {
+    VIEW_YAW += CURSOR_X_DELTA;
+    VIEW_PITCH += CURSOR_Y_DELTA;
+    CURSOR_X_DELTA = 0.0f;
+    CURSOR_Y_DELTA = 0.0f;
+    if (PITCH_LIMIT < VIEW_PITCH) {
+        VIEW_PITCH = PITCH_LIMIT;
+    } else if (VIEW_PITCH < -PITCH_LIMIT) {
+        VIEW_PITCH = -PITCH_LIMIT;
     }
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE) {
-        state->player.jump_key_released = true;
+    VIEW_TARGET.x =
+        cosf(get_radians(VIEW_YAW)) * cosf(get_radians(VIEW_PITCH));
+    VIEW_TARGET.y = sinf(get_radians(VIEW_PITCH));
+    VIEW_TARGET.z =
+        sinf(get_radians(VIEW_YAW)) * cosf(get_radians(VIEW_PITCH));
+    VIEW_TARGET = norm(VIEW_TARGET);
+}
+
+// NOTE: Keys arrive through `key_callback` as they happen; the view is only
+// pushed once per frame, along with the held keys, which resends any key
+// event the queue dropped.
+static void set_input() {
+    TRACE_SCOPE("set_input");
+    const u64 time = pacing_now();
+    if (TRAIN_FRAMES) {
+        const Input input =
+            get_scripted_input(PACING.frames * FRAME_UPDATE_COUNT);
+        VIEW_TARGET = input.view_target;
+        input_push_keys(&INPUT_QUEUE, time, input.keys);
+    } else {
+        input_push_keys(&INPUT_QUEUE, time, INPUT_QUEUE.held);
+        set_look();
     }
+    input_push_look(&INPUT_QUEUE, time, VIEW_TARGET);
 }
 
-static void set_player(State* state) {
-    state->player.position = INIT_PLAYER_POSITION;
-    state->player.speed = {};
-    state->player.can_jump = false;
-    state->player.jump_key_released = false;
+static void set_view() {
     VIEW_TARGET = INIT_VIEW_TARGET;
     CURSOR_X_DELTA = 0.0f;
     CURSOR_Y_DELTA = 0.0f;
@@ -161,280 +233,337 @@ static void set_player(State* state) {
     VIEW_PITCH = 0.0f;
 }
 
-static Cube get_cube_below(Player player) {
-    const f32 bottom = player.position.y - PLAYER_HEIGHT;
-    return {
-        {
-            player.position.x - PLAYER_WIDTH_HALF,
-            bottom + player.speed.y,
-            player.position.z - PLAYER_DEPTH_HALF,
-        },
-        {
-            player.position.x + PLAYER_WIDTH_HALF,
-            bottom,
-            player.position.z + PLAYER_DEPTH_HALF,
-        },
-    };
+static void set_frame(const State* state) {
+    TRACE_SCOPE("set_frame");
+    if ((PROJECTION.width != WINDOW_WIDTH) ||
+        (PROJECTION.height != WINDOW_HEIGHT))
+    {
+        PROJECTION.matrix = perspective(get_radians(45.0f),
+                                        static_cast<f32>(WINDOW_WIDTH) /
+                                            static_cast<f32>(WINDOW_HEIGHT),
+                                        VIEW_NEAR,
+                                        VIEW_FAR);
+        PROJECTION.width = WINDOW_WIDTH;
+        PROJECTION.height = WINDOW_HEIGHT;
+    }
+    const Mat4 view = look_at(state->player.position,
+                              state->player.position + VIEW_TARGET,
+                              VIEW_UP);
+    scene_set_frame(&PROJECTION.matrix, &view, state->player.position);
+    CHECK_GL_ERROR();
 }
 
-static Cube get_cube_above(Player player) {
-    return {
-        {
-            player.position.x - PLAYER_WIDTH_HALF,
-            player.position.y,
-            player.position.z - PLAYER_DEPTH_HALF,
-        },
-        {
-            player.position.x + PLAYER_WIDTH_HALF,
-            player.position.y + player.speed.y,
-            player.position.z + PLAYER_DEPTH_HALF,
-        },
-    };
+static f64 get_milliseconds(u64 nanoseconds) {
+    return static_cast<f64>(nanoseconds) / NANOSECONDS_PER_MILLISECOND;
 }
 
-static Cube get_cube_front(Player player) {
-    const Vec3 top_right_back = {
-        player.position.x + PLAYER_WIDTH_HALF,
-        player.position.y,
-        player.position.z - PLAYER_DEPTH_HALF,
-    };
-    return {
-        {
-            player.position.x - PLAYER_WIDTH_HALF,
-            player.position.y - PLAYER_HEIGHT,
-            top_right_back.z + player.speed.z,
-        },
-        top_right_back,
-    };
+static void log_summary(FILE*                   log,
+                        u64                     time,
+                        const char*             name,
+                        const HistogramSummary* summary) {
+    fprintf(log,
+            "%" PRIu64 ",%s,%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+            "\n",
+            time - PACING.start,
+            name,
+            summary->count,
+            summary->p50,
+            summary->p99,
+            summary->p999,
+            summary->max);
 }
 
-static Cube get_cube_back(Player player) {
-    const Vec3 bottom_left_front = {
-        player.position.x - PLAYER_WIDTH_HALF,
-        player.position.y - PLAYER_HEIGHT,
-        player.position.z + PLAYER_DEPTH_HALF,
-    };
-    return {
-        bottom_left_front,
-        {
-            player.position.x + PLAYER_WIDTH_HALF,
-            player.position.y,
-            bottom_left_front.z + player.speed.z,
-        },
-    };
+// NOTE: Once per window; percentiles show the tail that an average hides.
+static void set_debug(Frame* frame, const State* state) {
+    if ((frame->time - frame->window_time) < TELEMETRY_WINDOW) {
+        return;
+    }
+    frame->summary = histogram_rolling_next(&frame->histogram);
+    const HistogramSummary summary = frame->summary;
+    printf("\033[10A"
+           "frame    %8.3f%8.3f%8.3f%8.3f\n"
+           "tick     %8.3f%8.3f%8.3f%8.3f\n"
+           "sleep    %8.3f%8.3f%8.3f%8.3f\n"
+           "missed   %8" PRIu64 "%8" PRIu64 "\n"
+           "scale    %8.2f%8.2f\n"
+           "gpu      %8.2f%8.2f%8.2f%8.2f%8.2f%8.2f\n"
+           "latency  %8.2f\n"
+           "position %8.2f%8.2f%8.2f\n"
+           "speed    %8.2f%8.2f%8.2f\n"
+           "target   %8.2f%8.2f%8.2f\n",
+           get_milliseconds(summary.p50),
+           get_milliseconds(summary.p99),
+           get_milliseconds(summary.p999),
+           get_milliseconds(summary.max),
+           get_milliseconds(state->tick.p50),
+           get_milliseconds(state->tick.p99),
+           get_milliseconds(state->tick.p999),
+           get_milliseconds(state->tick.max),
+           get_milliseconds(state->sleep.p50),
+           get_milliseconds(state->sleep.p99),
+           get_milliseconds(state->sleep.p999),
+           get_milliseconds(state->sleep.max),
+           PACING.missed,
+           PACING.frames,
+           static_cast<f64>(RESOLUTION.scale),
+           static_cast<f64>(TIMER.gpu_time / MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(TIMER.pass_time[TIMER_CLEAR] /
+                            MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(TIMER.pass_time[TIMER_DRAW] /
+                            MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(TIMER.pass_time[TIMER_HIZ] /
+                            MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(TIMER.pass_time[TIMER_CULL] /
+                            MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(TIMER.pass_time[TIMER_DRAW_NEW] /
+                            MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(TIMER.pass_time[TIMER_BLIT] /
+                            MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(frame->latency / MICROSECONDS_PER_MILLISECOND),
+           static_cast<f64>(state->player.position.x),
+           static_cast<f64>(state->player.position.y),
+           static_cast<f64>(state->player.position.z),
+           static_cast<f64>(state->player.speed.x),
+           static_cast<f64>(state->player.speed.y),
+           static_cast<f64>(state->player.speed.z),
+           static_cast<f64>(VIEW_TARGET.x),
+           static_cast<f64>(VIEW_TARGET.y),
+           static_cast<f64>(VIEW_TARGET.z));
+    if (frame->log) {
+        log_summary(frame->log, frame->time, "frame", &summary);
+        // NOTE: The simulation rolls its window on its own clock; only log
+        // its summaries once they are new.
+        if (frame->window != state->window) {
+            log_summary(frame->log, state->time, "tick", &state->tick);
+            log_summary(frame->log, state->time, "sleep", &state->sleep);
+            frame->window = state->window;
+        }
+    }
+    frame->window_time = frame->time;
 }
 
-static Cube get_cube_left(Player player) {
-    const Vec3 top_right_back = {
-        player.position.x - PLAYER_WIDTH_HALF,
-        player.position.y,
-        player.position.z + PLAYER_DEPTH_HALF,
-    };
-    return {
-        {
-            top_right_back.x + player.speed.x,
-            player.position.y - PLAYER_HEIGHT,
-            player.position.z - PLAYER_DEPTH_HALF,
-        },
-        top_right_back,
-    };
+static_assert(METRICS_PASSES == TIMER_PASSES, "METRICS_PASSES");
+
+static void set_metrics(const Frame* frame, const State* state) {
+    MetricsData data;
+    data.time = frame->time - PACING.start;
+    data.frames = PACING.frames;
+    data.missed = PACING.missed;
+    data.ticks = state->ticks;
+    data.hash_queries = state->hash_queries;
+    data.hash_candidates = state->hash_candidates;
+    data.frame = frame->summary;
+    data.tick = state->tick;
+    data.sleep = state->sleep;
+    data.frame_time = frame->interval;
+    data.latency = frame->latency;
+    data.scale = RESOLUTION.scale;
+    data.gpu_time = TIMER.gpu_time;
+    for (u8 i = 0; i < TIMER_PASSES; ++i) {
+        data.pass_time[i] = TIMER.pass_time[i];
+    }
+    data.position = state->player.position;
+    data.speed = state->player.speed;
+    data.target = VIEW_TARGET;
+    data.respawns = state->player.respawns;
+    metrics_publish(&data);
 }
 
-static Cube get_cube_right(Player player) {
-    const Vec3 bottom_left_front = {
-        player.position.x + PLAYER_WIDTH_HALF,
-        player.position.y - PLAYER_HEIGHT,
-        player.position.z - PLAYER_DEPTH_HALF,
-    };
-    return {
-        bottom_left_front,
-        {
-            bottom_left_front.x + player.speed.x,
-            player.position.y,
-            player.position.z + PLAYER_DEPTH_HALF,
-        },
-    };
+// NOTE: Only under `--train`, where `step` is `0`; returns `false` if the
+// render thread stopped the simulation while it waited for more ticks.
+static bool wait_budget(Simulation* simulation, u64 ticks) {
+    while (__atomic_load_n(&simulation->budget, __ATOMIC_ACQUIRE) <= ticks) {
+        if (!__atomic_load_n(&simulation->running, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        pacing_sleep_until(pacing_now() + TRAIN_POLL);
+    }
+    return true;
 }
 
-#define INTERSECT_PLAYER_PLATFORM(player, platform)              \
-    ((player.bottom_left_front.x < platform.top_right_back.x) && \
-     (platform.bottom_left_front.x < player.top_right_back.x) && \
-     (player.bottom_left_front.y < platform.top_right_back.y) && \
-     (platform.bottom_left_front.y < player.top_right_back.y) && \
-     (player.bottom_left_front.z < platform.top_right_back.z) && \
-     (platform.bottom_left_front.z < player.top_right_back.z))
-
-#define WITHIN_SPEED_EPSILON(x) \
-    ((-SPEED_EPSILON < (x)) && ((x) < SPEED_EPSILON))
-
-template <usize N, usize M>
-static void set_motion(GridMemory<N, M>* memory, State* state) {
-    if (state->player.position.y < WORLD_Y_MIN) {
-        set_player(state);
-        return;
+// NOTE: Grants this frame's ticks, then waits until the last frame's have
+// been published, so the simulation runs this frame's while it renders.
+static void set_budget(Simulation* simulation) {
+    const u64 ticks = PACING.frames * FRAME_UPDATE_COUNT;
+    __atomic_store_n(&simulation->budget,
+                     ticks + FRAME_UPDATE_COUNT,
+                     __ATOMIC_RELEASE);
+    while (triple_get_front(&simulation->state)->ticks < ticks) {
+        pacing_sleep_until(pacing_now() + TRAIN_POLL);
     }
-    state->player.speed.y -= GRAVITY;
-    state->player.can_jump = false;
-    f32 x_speed = state->player.speed.x * DRAG;
-    f32 z_speed = state->player.speed.z * DRAG;
-    if (state->player.speed.y <= 0.0f) {
-        const Cube below = get_cube_below(state->player);
-        state->player.position.y += state->player.speed.y;
-        hash_set_intersects(memory, &below);
-        for (u8 i = 0; i < memory->len_intersects; ++i) {
-            if (INTERSECT_PLAYER_PLATFORM(below, (*memory->intersects[i]))) {
-                state->player.position.y =
-                    memory->intersects[i]->top_right_back.y + PLAYER_HEIGHT;
-                state->player.speed.y = 0.0f;
-                x_speed = state->player.speed.x * FRICTION;
-                z_speed = state->player.speed.z * FRICTION;
-                if (state->player.jump_key_released) {
-                    state->player.can_jump = true;
-                }
-                break;
-            }
+}
+
+// NOTE: Fixed-step simulation thread. Consumes the latest `Input` the render
+// thread published and publishes a `State` snapshot after every tick.
+static void* simulate(void* argument) {
+    Simulation* simulation = reinterpret_cast<Simulation*>(argument);
+    TRACE_SET_THREAD("simulate");
+    State state = *triple_get_back(&simulation->state);
+    u64   next = pacing_now();
+    u64   window_time = next;
+    histogram_rolling_reset(&simulation->tick);
+    histogram_rolling_reset(&simulation->sleep);
+    while (__atomic_load_n(&simulation->running, __ATOMIC_ACQUIRE)) {
+        if ((!simulation->step) && (!wait_budget(simulation, state.ticks))) {
+            break;
         }
-    } else {
-        const Cube above = get_cube_above(state->player);
-        state->player.position.y += state->player.speed.y;
-        hash_set_intersects(memory, &above);
-        for (u8 i = 0; i < memory->len_intersects; ++i) {
-            if (INTERSECT_PLAYER_PLATFORM(above, (*memory->intersects[i]))) {
-                state->player.position.y =
-                    memory->intersects[i]->bottom_left_front.y;
-                state->player.speed.y = 0.0f;
-                break;
-            }
+        const u64 now = pacing_now();
+        if (simulation->step) {
+            histogram_rolling_add(&simulation->sleep,
+                                  next < now ? now - next : 0);
         }
-    }
-    if (SPEED_MAX_SQUARED < ((x_speed * x_speed) + (z_speed * z_speed))) {
-        const f32 radians = atan2f(z_speed, x_speed);
-        state->player.speed.x = SPEED_MAX * cosf(radians);
-        state->player.speed.z = SPEED_MAX * sinf(radians);
-    } else {
-        state->player.speed.x = x_speed;
-        state->player.speed.z = z_speed;
-    }
-    state->player.position.y += GRAVITY;
-    const Cube front_back = state->player.speed.z < 0.0f
-                                ? get_cube_front(state->player)
-                                : get_cube_back(state->player);
-    const Cube left_right = state->player.speed.x < 0.0f
-                                ? get_cube_left(state->player)
-                                : get_cube_right(state->player);
-    state->player.position.y -= GRAVITY;
-    if (WITHIN_SPEED_EPSILON(state->player.speed.x)) {
-        state->player.speed.x = 0.0f;
-    } else {
-        state->player.position.x += state->player.speed.x;
-    }
-    if (WITHIN_SPEED_EPSILON(state->player.speed.z)) {
-        state->player.speed.z = 0.0f;
-    } else {
-        state->player.position.z += state->player.speed.z;
-    }
-    hash_set_intersects(memory, &front_back);
-    for (u8 i = 0; i < memory->len_intersects; ++i) {
-        if (INTERSECT_PLAYER_PLATFORM(front_back, (*memory->intersects[i]))) {
-            state->player.position.z -= state->player.speed.z;
-            state->player.speed.z = 0.0f;
+        state.time = now;
+        input_pop(&INPUT_QUEUE, now, &simulation->input);
+        set_speed(&simulation->input, &state.player);
+        state.input_time = simulation->input.time;
+        if (STREAM.enabled) {
+            simulation->memory = stream_get_grid();
         }
-    }
-    hash_set_intersects(memory, &left_right);
-    for (u8 i = 0; i < memory->len_intersects; ++i) {
-        if (INTERSECT_PLAYER_PLATFORM(left_right, (*memory->intersects[i]))) {
-            state->player.position.x -= state->player.speed.x;
-            state->player.speed.x = 0.0f;
+        set_motion(simulation->memory, &state.player);
+        {
+            const u64 tick = pacing_now() - now;
+            histogram_rolling_add(&simulation->tick, tick);
+            state.tick_time += tick;
+        }
+        ++state.ticks;
+        state.hash_queries = simulation->memory->count_queries;
+        state.hash_candidates = simulation->memory->count_candidates;
+        if (TELEMETRY_WINDOW <= (now - window_time)) {
+            state.tick = histogram_rolling_next(&simulation->tick);
+            state.sleep = histogram_rolling_next(&simulation->sleep);
+            ++state.window;
+            window_time = now;
+        }
+        *triple_get_back(&simulation->state) = state;
+        triple_publish(&simulation->state);
+        if (!simulation->step) {
+            continue;
         }
+        next += simulation->step;
+        {
+            const u64 after = pacing_now();
+            if ((next + FRAME_UPDATE_BACKLOG) < after) {
+                next = after;
+            }
+        }
+        pacing_sleep_until(next);
     }
+    return null;
 }
 
-static void set_uniforms(Uniform uniform, const State* state) {
-    glUniform1f(uniform.time, state->time);
-    glUniform3f(uniform.position,
-                state->player.position.x,
-                state->player.position.y,
-                state->player.position.z);
-    const Mat4 projection = perspective(get_radians(45.0f),
-                                        static_cast<f32>(WINDOW_WIDTH) /
-                                            static_cast<f32>(WINDOW_HEIGHT),
-                                        VIEW_NEAR,
-                                        VIEW_FAR);
-    glUniformMatrix4fv(uniform.projection, 1, false, &projection.cell[0][0]);
-    const Mat4 view = look_at(state->player.position,
-                              state->player.position + VIEW_TARGET,
-                              VIEW_UP);
-    glUniformMatrix4fv(uniform.view, 1, false, &view.cell[0][0]);
-    CHECK_GL_ERROR();
-}
-
-static void set_debug(Frame* frame, const State* state) {
-    if (++frame->debug_count == 30) {
-        printf("\033[5A"
-               "fps      %8.2f\n"
-               "mspf     %8.2f\n"
-               "position %8.2f%8.2f%8.2f\n"
-               "speed    %8.2f%8.2f%8.2f\n"
-               "target   %8.2f%8.2f%8.2f\n",
-               static_cast<f64>(
-                   (frame->debug_count / (frame->time - frame->debug_time)) *
-                   MICROSECONDS),
-               static_cast<f64>(
-                   ((frame->time - frame->debug_time) / frame->debug_count) /
-                   MILLISECONDS),
-               static_cast<f64>(state->player.position.x),
-               static_cast<f64>(state->player.position.y),
-               static_cast<f64>(state->player.position.z),
-               static_cast<f64>(state->player.speed.x),
-               static_cast<f64>(state->player.speed.y),
-               static_cast<f64>(state->player.speed.z),
-               static_cast<f64>(VIEW_TARGET.x),
-               static_cast<f64>(VIEW_TARGET.y),
-               static_cast<f64>(VIEW_TARGET.z));
-        frame->debug_time = frame->time;
-        frame->debug_count = 0;
+static void loop(GLFWwindow* window, Simulation* simulation, FILE* log) {
+    {
+        set_view();
+        input_reset(&INPUT_QUEUE);
+        simulation->input = {
+            VIEW_TARGET,
+            pacing_now(),
+            0,
+        };
+        State state = {};
+        set_player(&state.player);
+        state.time = simulation->input.time;
+        state.input_time = simulation->input.time;
+        triple_set(&simulation->state, &state);
     }
-}
-
-template <usize N, usize M>
-static void loop(GLFWwindow* window, GridMemory<N, M>* memory, u32 program) {
-    State state;
-    set_player(&state);
     Frame frame = {};
-    glUseProgram(program);
-    const Uniform uniform = {
-        glGetUniformLocation(program, "TIME"),
-        glGetUniformLocation(program, "POSITION"),
-        glGetUniformLocation(program, "PROJECTION"),
-        glGetUniformLocation(program, "VIEW"),
-    };
-    printf("\n\n\n\n\n");
+    frame.log = log;
+    frame.time = pacing_now();
+    frame.window_time = frame.time;
+    if (frame.log) {
+        fprintf(frame.log, "time,name,count,p50,p99,p999,max\n");
+    }
+    u32 respawns = triple_get_front(&simulation->state)->player.respawns;
+    TRACE_SET_THREAD("render");
+    simulation->budget = 0;
+    __atomic_store_n(&simulation->running, true, __ATOMIC_RELEASE);
+    pthread_t thread;
+    EXIT_IF(pthread_create(&thread, null, simulate, simulation));
+    printf("\n\n\n\n\n\n\n\n\n\n");
     while (!glfwWindowShouldClose(window)) {
-        state.time = static_cast<f32>(glfwGetTime());
-        frame.time = state.time * MICROSECONDS;
-        frame.delta += frame.time - frame.prev;
-        while (FRAME_UPDATE_STEP < frame.delta) {
-            set_input(window, &state);
-            set_motion(memory, &state);
-            frame.delta -= FRAME_UPDATE_STEP;
+        wait_events();
+        {
+            const u64 time = pacing_begin();
+            frame.interval = time - frame.time;
+            histogram_rolling_add(&frame.histogram, frame.interval);
+            frame.time = time;
+        }
+        resolution_set(WINDOW_WIDTH, WINDOW_HEIGHT);
+        // NOTE: Input, the latest simulation snapshot, and with them the view
+        // matrix are latched after the wait and as close to submitting the
+        // draw as possible.
+        set_input();
+        if (TRAIN_FRAMES) {
+            set_budget(simulation);
+        }
+        const State* state = triple_get_front(&simulation->state);
+        if (state->player.respawns != respawns) {
+            respawns = state->player.respawns;
+            set_view();
+        }
+        if (STREAM.enabled) {
+            stream_set_center(state->player.position);
+            stream_upload();
         }
-        set_uniforms(uniform, &state);
         {
-            const f32 sin_height = sinf(state.player.position.y / 10.0f);
+            const f32 sin_height = sinf(state->player.position.y / 10.0f);
             glClearColor(sin_height, sin_height, sin_height, 1.0f);
         }
-        scene_draw<FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT>(window,
-                                                            WINDOW_WIDTH,
-                                                            WINDOW_HEIGHT);
+        set_frame(state);
+        scene_draw(WINDOW_WIDTH, WINDOW_HEIGHT);
+        if (CAPTURE.enabled) {
+            capture_frame();
+        }
+        glfwSwapBuffers(window);
+        pacing_end();
+        if (!STARTUP.first_frame) {
+            STARTUP.first_frame = pacing_now();
+        }
+        TRACE_END_FRAME(PACING.frames, frame.time, pacing_now());
         {
-            const f32 elapsed =
-                (static_cast<f32>(glfwGetTime()) * MICROSECONDS) - frame.time;
-            if (elapsed < FRAME_DURATION) {
-                usleep(static_cast<u32>(FRAME_DURATION - elapsed));
+            // NOTE: From the newest input event this frame's state applied to
+            // the swap returning; the closest proxy for input-to-photon.
+            const u64 now = pacing_now();
+            const f32 latency =
+                pacing_get_microseconds(now, state->input_time);
+            frame.latency += (latency - frame.latency) * JITTER_SMOOTHING;
+            if (LATENCY && (frame.input_time != state->input_time)) {
+                frame.input_time = state->input_time;
+                histogram_add(&frame.input, now - state->input_time);
             }
-            set_debug(&frame, &state);
         }
-        frame.prev = frame.time;
+        set_debug(&frame, state);
+        set_metrics(&frame, state);
+        if (TRAIN_FRAMES && (TRAIN_FRAMES <= PACING.frames)) {
+            glfwSetWindowShouldClose(window, true);
+        }
+    }
+    __atomic_store_n(&simulation->running, false, __ATOMIC_RELEASE);
+    EXIT_IF(pthread_join(thread, null));
+    if (TRAIN_FRAMES) {
+        const f64 elapsed =
+            static_cast<f64>(pacing_now() - PACING.start) / NANOSECONDS;
+        const State* state = triple_get_front(&simulation->state);
+        // NOTE: Lockstep ties ticks to frames, so steps per second counts
+        // only the time spent inside ticks, not the time spent waiting.
+        printf("train    %8" PRIu64 " frames %10.3f ms/frame %10" PRIu64
+               " steps %12.1f steps/s\n",
+               PACING.frames,
+               (elapsed * 1000.0) / static_cast<f64>(PACING.frames),
+               state->ticks,
+               static_cast<f64>(state->ticks) /
+                   (static_cast<f64>(state->tick_time) / NANOSECONDS));
+    }
+    if (LATENCY) {
+        const HistogramSummary summary = histogram_get_summary(&frame.input);
+        printf("latency  %8u frames %10.3f ms p50 %10.3f ms p99 %10.3f ms "
+               "p999 %10.3f ms max %8" PRIu64 " dropped\n",
+               summary.count,
+               get_milliseconds(summary.p50),
+               get_milliseconds(summary.p99),
+               get_milliseconds(summary.p999),
+               get_milliseconds(summary.max),
+               INPUT_QUEUE.dropped);
     }
 }
 
@@ -443,86 +572,229 @@ static void loop(GLFWwindow* window, GridMemory<N, M>* memory, u32 program) {
     _exit(EXIT_FAILURE);
 }
 
-#define CURSOR_CALLBACK(x, y)                                            \
-    {                                                                    \
-        CURSOR_X = static_cast<f32>(x);                                  \
-        CURSOR_Y = static_cast<f32>(y);                                  \
-        VIEW_YAW += CURSOR_X_DELTA;                                      \
-        VIEW_PITCH += CURSOR_Y_DELTA;                                    \
-        if (PITCH_LIMIT < VIEW_PITCH) {                                  \
-            VIEW_PITCH = PITCH_LIMIT;                                    \
-        } else if (VIEW_PITCH < -PITCH_LIMIT) {                          \
-            VIEW_PITCH = -PITCH_LIMIT;                                   \
-        }                                                                \
-        VIEW_TARGET.x =                                                  \
-            cosf(get_radians(VIEW_YAW)) * cosf(get_radians(VIEW_PITCH)); \
-        VIEW_TARGET.y = sinf(get_radians(VIEW_PITCH));                   \
-        VIEW_TARGET.z =                                                  \
-            sinf(get_radians(VIEW_YAW)) * cosf(get_radians(VIEW_PITCH)); \
-        VIEW_TARGET = norm(VIEW_TARGET);                                 \
-    }
-
 static void cursor_callback(GLFWwindow*, f64 x, f64 y) {
-    CURSOR_X_DELTA = (static_cast<f32>(x) - CURSOR_X) * CURSOR_SENSITIVITY;
-    CURSOR_Y_DELTA = (CURSOR_Y - static_cast<f32>(y)) * CURSOR_SENSITIVITY;
-    CURSOR_CALLBACK(x, y);
+    CURSOR_X_DELTA += (static_cast<f32>(x) - CURSOR_X) * CURSOR_SENSITIVITY;
+    CURSOR_Y_DELTA += (CURSOR_Y - static_cast<f32>(y)) * CURSOR_SENSITIVITY;
+    CURSOR_X = static_cast<f32>(x);
+    CURSOR_Y = static_cast<f32>(y);
 }
 
 static void set_cursor_callback(GLFWwindow* window, f64 x, f64 y) {
-    CURSOR_CALLBACK(x, y);
+    CURSOR_X = static_cast<f32>(x);
+    CURSOR_Y = static_cast<f32>(y);
     glfwSetCursorPosCallback(window, cursor_callback);
 }
 
+static u8 get_key(i32 key) {
+    if (key == GLFW_KEY_W) {
+        return INPUT_KEY_W;
+    }
+    if (key == GLFW_KEY_A) {
+        return INPUT_KEY_A;
+    }
+    if (key == GLFW_KEY_S) {
+        return INPUT_KEY_S;
+    }
+    if (key == GLFW_KEY_D) {
+        return INPUT_KEY_D;
+    }
+    if (key == GLFW_KEY_SPACE) {
+        return INPUT_KEY_SPACE;
+    }
+    return 0;
+}
+
+// NOTE: Runs inside `glfwPollEvents` or `glfwWaitEventsTimeout`, so on the
+// render thread. Scripted input replaces the keyboard while training.
+static void key_callback(GLFWwindow* window, i32 key, i32, i32 action, i32) {
+    if (action == GLFW_REPEAT) {
+        return;
+    }
+    if (key == GLFW_KEY_ESCAPE) {
+        glfwSetWindowShouldClose(window, true);
+        return;
+    }
+    const u8 mask = get_key(key);
+    if (TRAIN_FRAMES || (!mask)) {
+        return;
+    }
+    input_push_key(&INPUT_QUEUE, pacing_now(), mask, action == GLFW_PRESS);
+}
+
 static void framebuffer_size_callback(GLFWwindow*, i32 width, i32 height) {
     WINDOW_WIDTH = width;
     WINDOW_HEIGHT = height;
 }
 
-static void* alloc(usize size) {
-    void* memory = mmap(null,
-                        size,
-                        PROT_READ | PROT_WRITE,
-                        MAP_ANONYMOUS | MAP_PRIVATE,
-                        -1,
-                        0);
-    EXIT_IF(memory == MAP_FAILED);
-    return memory;
+static bool get_flag(i32 argc, char** argv, const char* flag) {
+    for (i32 i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], flag)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static u64 get_rate(i32 argc, char** argv) {
+    const char* rate = get_arg(argc, argv, "--rate");
+    return rate ? strtoul(rate, null, 10) : FRAME_RATE;
+}
+
+static u64 get_train_frames(i32 argc, char** argv) {
+    const char* frames = get_arg(argc, argv, "--train");
+    return frames ? strtoul(frames, null, 10) : 0;
+}
+
+static u8 get_huge_pages(i32 argc, char** argv) {
+    const char* pages = get_arg(argc, argv, "--huge-pages");
+    if (!pages) {
+        return ARENA_PAGES_NORMAL;
+    }
+    if (!strcmp(pages, "transparent")) {
+        return ARENA_PAGES_TRANSPARENT;
+    }
+    if (!strcmp(pages, "explicit")) {
+        return ARENA_PAGES_EXPLICIT;
+    }
+    EXIT_WITH(pages);
+}
+
+// NOTE: Everything the previous level allocated goes with it. A streamed
+// level starts out with just the chunks around the spawn point resident.
+// Touches nothing GL, so it can run without a context.
+static void* load_level(void* argument) {
+    Load*     load = static_cast<Load*>(argument);
+    const u64 start = pacing_now();
+    arena_reset(&ARENAS.level);
+    level_open(load->path, load->stream);
+    if (load->stream) {
+        stream_open(INIT_PLAYER_POSITION);
+    } else {
+        level_set_grid(load->grid, &ARENAS.level);
+    }
+    load->time = pacing_now() - start;
+    return null;
+}
+
+static void set_level_buffers() {
+    if (STREAM.enabled) {
+        scene_set_buffers(FRAME_BUFFER_WIDTH,
+                          FRAME_BUFFER_HEIGHT,
+                          STREAM.instances,
+                          STREAM.platforms,
+                          stream_get_len());
+        return;
+    }
+    scene_set_buffers(FRAME_BUFFER_WIDTH,
+                      FRAME_BUFFER_HEIGHT,
+                      LEVEL.instances,
+                      LEVEL.platforms,
+                      LEVEL.len_platforms);
+}
+
+// NOTE: `scaled` when every instance only translates and scales (see
+// `LEVEL_SCALED`); `--unlit` drops lighting on top of that.
+static u32 get_variant(i32 argc, char** argv, bool scaled) {
+    return (scaled ? SHADER_SCALED : 0) |
+           (get_flag(argc, argv, "--unlit") ? SHADER_UNLIT : 0);
+}
+
+static u32 get_program(Memory* memory, const ShaderVariant* variant) {
+    const u32 program = init_get_program_cached(&memory->buffer,
+                                                &ARENAS.frame,
+                                                variant->vert,
+                                                variant->frag,
+                                                null);
+    arena_reset(&ARENAS.frame);
+    return program;
 }
 
-i32 main() {
-    Memory* memory = reinterpret_cast<Memory*>(alloc(sizeof(Memory)));
+// NOTE: `--timer-log <path>` writes one CSV row of per-pass GPU nanoseconds
+// per frame; `--histogram-log <path>` writes one row of percentiles per
+// histogram per `TELEMETRY_WINDOW`.
+static FILE* get_log(i32 argc, char** argv, const char* flag) {
+    const char* path = get_arg(argc, argv, flag);
+    if (!path) {
+        return null;
+    }
+    FILE* log = fopen(path, "w");
+    EXIT_IF(!log);
+    return log;
+}
+
+i32 main(i32 argc, char** argv) {
+    STARTUP.start = pacing_now();
+    arena_set(get_huge_pages(argc, argv));
+    Memory* memory = arena_alloc<Memory>(&ARENAS.permanent, 1);
+    // NOTE: `--stream` loads chunks around the player as it moves rather than
+    // the whole level up front; see `stream.hpp`.
+    Load load = {
+        &memory->grid,
+        get_arg(argc, argv, "--level"),
+        0,
+        get_flag(argc, argv, "--stream"),
+    };
+    if (!load.path) {
+        load.path = LEVEL_PATH;
+    }
+    pthread_t thread_load;
+    EXIT_IF(pthread_create(&thread_load, null, load_level, &load));
     printf("GLFW version : %s\n\n"
            "sizeof(Vec3)                                   : %zu\n"
            "sizeof(Mat4)                                   : %zu\n"
            "sizeof(Object)                                 : %zu\n"
+           "sizeof(Occlusion)                              : %zu\n"
+           "sizeof(Resolution)                             : %zu\n"
+           "sizeof(Timer)                                  : %zu\n"
            "sizeof(Instance)                               : %zu\n"
+           "sizeof(LevelHeader)                            : %zu\n"
+           "sizeof(LevelChunk)                             : %zu\n"
            "sizeof(Cube)                                   : %zu\n"
            "sizeof(Native)                                 : %zu\n"
            "sizeof(BufferMemory<CAP_CHARS>)                : %zu\n"
            "sizeof(Index)                                  : %zu\n"
            "sizeof(Range)                                  : %zu\n"
-           "sizeof(List)                                   : %zu\n"
-           "sizeof(GridMemory<CAP_LISTS, COUNT_PLATFORMS>) : %zu\n"
+           "sizeof(LevelGrid)                              : %zu\n"
+           "sizeof(GridMemory)                             : %zu\n"
+           "sizeof(Stream)                                 : %zu\n"
            "sizeof(Player)                                 : %zu\n"
+           "sizeof(Histogram)                              : %zu\n"
            "sizeof(Frame)                                  : %zu\n"
-           "sizeof(Uniform)                                : %zu\n"
+           "sizeof(Metrics)                                : %zu\n"
+           "sizeof(Arena)                                  : %zu\n"
+           "sizeof(Pacing)                                 : %zu\n"
+           "sizeof(SceneFrame)                             : %zu\n"
+           "sizeof(Input)                                  : %zu\n"
+           "sizeof(InputEvent)                             : %zu\n"
            "sizeof(State)                                  : %zu\n"
            "sizeof(Memory)                                 : %zu\n\n",
            glfwGetVersionString(),
            sizeof(Vec3),
            sizeof(Mat4),
            sizeof(Object),
+           sizeof(Occlusion),
+           sizeof(Resolution),
+           sizeof(Timer),
            sizeof(Instance),
+           sizeof(LevelHeader),
+           sizeof(LevelChunk),
            sizeof(Cube),
            sizeof(Native),
            sizeof(BufferMemory<CAP_CHARS>),
            sizeof(Index),
            sizeof(Range),
-           sizeof(List),
-           sizeof(GridMemory<CAP_LISTS, COUNT_PLATFORMS>),
+           sizeof(LevelGrid),
+           sizeof(GridMemory),
+           sizeof(Stream),
            sizeof(Player),
+           sizeof(Histogram),
            sizeof(Frame),
-           sizeof(Uniform),
+           sizeof(Metrics),
+           sizeof(Arena),
+           sizeof(Pacing),
+           sizeof(SceneFrame),
+           sizeof(Input),
+           sizeof(InputEvent),
            sizeof(State),
            sizeof(Memory));
     glfwSetErrorCallback(error_callback);
@@ -530,25 +802,97 @@ i32 main() {
     GLFWwindow* window =
         init_get_window<INIT_WINDOW_WIDTH, INIT_WINDOW_HEIGHT>("float");
     glfwSetCursorPosCallback(window, set_cursor_callback);
+    glfwSetKeyCallback(window, key_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    const u32 program = init_get_program(
-        &memory->buffer,
-        init_get_shader(&memory->buffer, SHADER_VERT, GL_VERTEX_SHADER),
-        init_get_shader(&memory->buffer, SHADER_FRAG, GL_FRAGMENT_SHADER));
-    scene_set_buffers<FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT>();
-    hash_set_bounds<CAP_LISTS, COUNT_PLATFORMS, PLATFORMS>(&memory->grid);
-    hash_set_grid<CAP_LISTS, COUNT_PLATFORMS, PLATFORMS>(&memory->grid);
+    // NOTE: Programs are built while the level is still loading, so this
+    // bets on the scaled variant every exporter writes and only builds the
+    // general one once the header turns out to say otherwise.
+    u32 program;
+    {
+        const u64 start = pacing_now();
+        init_set_cache();
+        program = get_program(
+            memory,
+            &SHADER_VARIANTS[get_variant(argc, argv, true)]);
+        occlusion_set_programs(&memory->buffer, &ARENAS.frame);
+        arena_reset(&ARENAS.frame);
+        STARTUP.programs = pacing_now() - start;
+    }
+    EXIT_IF(pthread_join(thread_load, null));
+    if (!(LEVEL.header->flags & LEVEL_SCALED)) {
+        const u64 start = pacing_now();
+        glDeleteProgram(program);
+        program = get_program(
+            memory,
+            &SHADER_VARIANTS[get_variant(argc, argv, false)]);
+        STARTUP.programs += pacing_now() - start;
+    }
+    set_level_buffers();
+    scene_set_program(program);
+    {
+        const char* path = get_arg(argc, argv, "--capture");
+        if (path) {
+            capture_open(path);
+        }
+    }
+    TRAIN_FRAMES = get_train_frames(argc, argv);
+    LATENCY = get_flag(argc, argv, "--latency");
+    pacing_set(TRAIN_FRAMES ? 0 : get_rate(argc, argv));
+    // NOTE: The pacer owns the cadence, and vsync on top of it would pace
+    // every frame twice. Only an unpaced interactive run (`--rate 0`) falls
+    // back on vsync; training runs with neither.
+    glfwSwapInterval((PACING.period || TRAIN_FRAMES) ? 0 : 1);
+    TRACE_SET(get_arg(argc, argv, "--trace"));
+    timer_set_queries(get_log(argc, argv, "--timer-log"));
+    // NOTE: Unpaced frames still budget for the default rate, so the
+    // resolution controller behaves the same while training.
+    resolution_set_scale(FRAME_BUFFER_SCALE,
+                         FRAME_BUFFER_SCALE_MAX,
+                         static_cast<f32>(PACING.period
+                                              ? PACING.period
+                                              : NANOSECONDS / FRAME_RATE) /
+                             1000.0f,
+                         INIT_WINDOW_WIDTH,
+                         INIT_WINDOW_HEIGHT);
     {
         const Native native = {
             glfwGetX11Display(),
             glfwGetX11Window(window),
         };
         init_hide_cursor(native);
-        loop(window, &memory->grid, program);
+        memory->simulation.memory = &memory->grid;
+        memory->simulation.step = TRAIN_FRAMES ? 0 : FRAME_UPDATE_STEP;
+        FILE* log = get_log(argc, argv, "--histogram-log");
+        metrics_open();
+        if (STREAM.enabled) {
+            stream_start();
+        }
+        loop(window, &memory->simulation, log);
+        if (STREAM.enabled) {
+            stream_close();
+        }
+        if (CAPTURE.enabled) {
+            capture_close();
+        }
+        metrics_close();
+        if (log) {
+            EXIT_IF(fclose(log));
+        }
         init_show_cursor(native);
     }
+    printf("startup  %10.3f ms to first frame %10.3f ms level %10.3f ms "
+           "programs (%u cached, %u compiled)\n",
+           get_milliseconds(STARTUP.first_frame - STARTUP.start),
+           get_milliseconds(load.time),
+           get_milliseconds(STARTUP.programs),
+           INIT_CACHE.hits,
+           INIT_CACHE.misses);
+    timer_delete_queries();
     scene_delete_buffers();
+    occlusion_delete_programs();
+    level_close();
     glDeleteProgram(program);
     glfwTerminate();
+    arena_delete();
     return EXIT_SUCCESS;
 }
@@ -3,10 +3,15 @@
 
 #include "prelude.hpp"
 
+#include <immintrin.h>
+
 #define MIN(l, r) ((l) < (r) ? (l) : (r))
 #define MAX(l, r) ((l) < (r) ? (r) : (l))
 
-static Vec3 min(Vec3 l, Vec3 r) {
+// NOTE: `Vec3` stays a packed 12-byte struct, since that is the layout the
+// instance buffers and `Cube` bounds hand to GL. Its scalar operators are
+// `constexpr`; anything hot works on `Simd4f32` lanes below instead.
+static constexpr Vec3 min(Vec3 l, Vec3 r) {
     return {
         MIN(l.x, r.x),
         MIN(l.y, r.y),
@@ -14,7 +19,7 @@ static Vec3 min(Vec3 l, Vec3 r) {
     };
 }
 
-static Vec3 max(Vec3 l, Vec3 r) {
+static constexpr Vec3 max(Vec3 l, Vec3 r) {
     return {
         MAX(l.x, r.x),
         MAX(l.y, r.y),
@@ -22,15 +27,15 @@ static Vec3 max(Vec3 l, Vec3 r) {
     };
 }
 
-static Vec3 clip(Vec3 x, Vec3 l, Vec3 r) {
+static constexpr Vec3 clip(Vec3 x, Vec3 l, Vec3 r) {
     return min(r, max(l, x));
 }
 
-static f32 get_radians(f32 degrees) {
+static constexpr f32 get_radians(f32 degrees) {
     return (degrees * PI) / 180.0f;
 }
 
-static Vec3 operator+(Vec3 l, Vec3 r) {
+static constexpr Vec3 operator+(Vec3 l, Vec3 r) {
     return {
         l.x + r.x,
         l.y + r.y,
@@ -52,7 +57,7 @@ static Vec3& operator+=(Vec3& l, f32 r) {
     return l;
 }
 
-static Vec3 operator-(Vec3 l, Vec3 r) {
+static constexpr Vec3 operator-(Vec3 l, Vec3 r) {
     return {
         l.x - r.x,
         l.y - r.y,
@@ -67,7 +72,7 @@ static Vec3& operator-=(Vec3& a, Vec3 b) {
     return a;
 }
 
-static Vec3 operator-(Vec3 l, f32 r) {
+static constexpr Vec3 operator-(Vec3 l, f32 r) {
     return {
         l.x - r,
         l.y - r,
@@ -75,7 +80,7 @@ static Vec3 operator-(Vec3 l, f32 r) {
     };
 }
 
-static Vec3 operator*(Vec3 l, Vec3 r) {
+static constexpr Vec3 operator*(Vec3 l, Vec3 r) {
     return {
         l.x * r.x,
         l.y * r.y,
@@ -83,7 +88,7 @@ static Vec3 operator*(Vec3 l, Vec3 r) {
     };
 }
 
-static Vec3 operator*(Vec3 l, f32 r) {
+static constexpr Vec3 operator*(Vec3 l, f32 r) {
     return {
         l.x * r,
         l.y * r,
@@ -91,7 +96,14 @@ static Vec3 operator*(Vec3 l, f32 r) {
     };
 }
 
-static Vec3 operator/(Vec3 l, Vec3 r) {
+static Vec3& operator*=(Vec3& l, Vec3 r) {
+    l.x *= r.x;
+    l.y *= r.y;
+    l.z *= r.z;
+    return l;
+}
+
+static constexpr Vec3 operator/(Vec3 l, Vec3 r) {
     return {
         l.x / r.x,
         l.y / r.y,
@@ -99,7 +111,7 @@ static Vec3 operator/(Vec3 l, Vec3 r) {
     };
 }
 
-static Vec3 operator/(Vec3 l, f32 r) {
+static constexpr Vec3 operator/(Vec3 l, f32 r) {
     return {
         l.x / r,
         l.y / r,
@@ -107,7 +119,7 @@ static Vec3 operator/(Vec3 l, f32 r) {
     };
 }
 
-static Vec3 cross(Vec3 l, Vec3 r) {
+static constexpr Vec3 cross(Vec3 l, Vec3 r) {
     return {
         (l.y * r.z) - (l.z * r.y),
         (l.z * r.x) - (l.x * r.z),
@@ -115,7 +127,7 @@ static Vec3 cross(Vec3 l, Vec3 r) {
     };
 }
 
-static f32 dot(Vec3 l, Vec3 r) {
+static constexpr f32 dot(Vec3 l, Vec3 r) {
     return (l.x * r.x) + (l.y * r.y) + (l.z * r.z);
 }
 
@@ -139,28 +151,175 @@ static Mat4 perspective(f32 fov_radians, f32 aspect_ratio, f32 near, f32 far) {
     };
 }
 
+// NOTE: `Simd4f32` as a 3-vector keeps `w` in the top lane. `dot` ignores it
+// and `cross` of two vectors with `w == 0` leaves it at `0`.
+static Simd4f32 simd_get(Vec3 x, f32 w) {
+    return _mm_set_ps(w, x.z, x.y, x.x);
+}
+
+static Vec3 simd_get_vec3(Simd4f32 x) {
+    Vec4 y;
+    y.simd = x;
+    return {y.cell[0], y.cell[1], y.cell[2]};
+}
+
+// NOTE: Result is splatted across all four lanes.
+static Simd4f32 simd_dot(Simd4f32 l, Simd4f32 r) {
+#ifdef __SSE4_1__
+    return _mm_dp_ps(l, r, 0x7F);
+#else
+    const Simd4f32 x = _mm_mul_ps(l, r);
+    return _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(x, x, 0x00),
+                                 _mm_shuffle_ps(x, x, 0x55)),
+                      _mm_shuffle_ps(x, x, 0xAA));
+#endif
+}
+
+static Simd4f32 simd_cross(Simd4f32 l, Simd4f32 r) {
+    const Simd4f32 x = _mm_sub_ps(_mm_mul_ps(l, _mm_shuffle_ps(r, r, 0xC9)),
+                                  _mm_mul_ps(_mm_shuffle_ps(l, l, 0xC9), r));
+    return _mm_shuffle_ps(x, x, 0xC9);
+}
+
+static Simd4f32 simd_norm(Simd4f32 x) {
+    return _mm_div_ps(x, _mm_sqrt_ps(simd_dot(x, x)));
+}
+
+// NOTE: `simd_dot`, `simd_cross` and `simd_norm` have no AVX versions. One
+// 3-vector doesn't fill a 128-bit register, and their only hot caller,
+// `look_at`, feeds each result into the next, so there is never a second
+// independent vector to put in the upper lane. Batches of points go through
+// `transform`, which does have one.
+
+static Simd4f32 linear_combine(Simd4f32 a, Mat4 b) {
+    Simd4f32 c;
+    c = _mm_mul_ps(_mm_shuffle_ps(a, a, 0x00), b.column[0]);
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(a, a, 0x55), b.column[1]));
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xAA), b.column[2]));
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xFF), b.column[3]));
+    return c;
+}
+
+#ifdef __AVX__
+
+// NOTE: Two columns of `b` at once; each 128-bit lane does exactly what
+// `linear_combine` does for one.
+static __m256 linear_combine_x2(__m256 a, Mat4 b) {
+    __m256 c;
+    c = _mm256_mul_ps(_mm256_permute_ps(a, 0x00),
+                      _mm256_broadcast_ps(&b.column[0]));
+    c = _mm256_add_ps(c,
+                      _mm256_mul_ps(_mm256_permute_ps(a, 0x55),
+                                    _mm256_broadcast_ps(&b.column[1])));
+    c = _mm256_add_ps(c,
+                      _mm256_mul_ps(_mm256_permute_ps(a, 0xAA),
+                                    _mm256_broadcast_ps(&b.column[2])));
+    c = _mm256_add_ps(c,
+                      _mm256_mul_ps(_mm256_permute_ps(a, 0xFF),
+                                    _mm256_broadcast_ps(&b.column[3])));
+    return c;
+}
+
+static Mat4 operator*(Mat4 l, Mat4 r) {
+    Mat4 m;
+    _mm256_storeu_ps(
+        &m.cell[0][0],
+        linear_combine_x2(_mm256_loadu_ps(&r.cell[0][0]), l));
+    _mm256_storeu_ps(
+        &m.cell[2][0],
+        linear_combine_x2(_mm256_loadu_ps(&r.cell[2][0]), l));
+    return m;
+}
+
+#else
+
+static Mat4 operator*(Mat4 l, Mat4 r) {
+    return {
+        .column[0] = linear_combine(r.column[0], l),
+        .column[1] = linear_combine(r.column[1], l),
+        .column[2] = linear_combine(r.column[2], l),
+        .column[3] = linear_combine(r.column[3], l),
+    };
+}
+
+#endif
+
+// NOTE: `m * points[i]` for every point.
+static void transform(const Mat4* m, const Vec4* points, Vec4* out, u32 n) {
+    u32 i = 0;
+#ifdef __AVX__
+    for (; (i + 1) < n; i += 2) {
+        _mm256_storeu_ps(
+            &out[i].cell[0],
+            linear_combine_x2(_mm256_loadu_ps(&points[i].cell[0]), *m));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i].simd = linear_combine(points[i].simd, *m);
+    }
+}
+
+// NOTE: Only valid for `[A t; 0 1]`, i.e. rotation, scale, and translation
+// with nothing projective. The rows of `A^-1` are the cross products of its
+// columns over the determinant; the new translation is `-(A^-1 t)`.
+static Mat4 affine_inverse(Mat4 m) {
+    const Simd4f32 bc = simd_cross(m.column[1], m.column[2]);
+    const Simd4f32 det = simd_dot(m.column[0], bc);
+    Mat4           inverse;
+    inverse.column[0] = _mm_div_ps(bc, det);
+    inverse.column[1] = _mm_div_ps(simd_cross(m.column[2], m.column[0]), det);
+    inverse.column[2] = _mm_div_ps(simd_cross(m.column[0], m.column[1]), det);
+    inverse.column[3] = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(inverse.column[0],
+                      inverse.column[1],
+                      inverse.column[2],
+                      inverse.column[3]);
+    inverse.column[3] = _mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f),
+                                   linear_combine(m.column[3], inverse));
+    return inverse;
+}
+
 static Mat4 look_at(Vec3 eye, Vec3 target, Vec3 up) {
-    const Vec3 f = norm(target - eye);
-    const Vec3 s = norm(cross(f, up));
-    const Vec3 u = cross(s, f);
+    const Simd4f32 e = simd_get(eye, 0.0f);
+    const Simd4f32 f = simd_norm(_mm_sub_ps(simd_get(target, 0.0f), e));
+    const Simd4f32 s = simd_norm(simd_cross(f, simd_get(up, 0.0f)));
+    Mat4           view;
+    view.column[0] = s;
+    view.column[1] = simd_cross(s, f);
+    view.column[2] = _mm_sub_ps(_mm_setzero_ps(), f);
+    view.column[3] = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(view.column[0],
+                      view.column[1],
+                      view.column[2],
+                      view.column[3]);
+    view.column[3] = _mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f),
+                                linear_combine(e, view));
+    return view;
+}
+
+static Mat4 diag(f32 x) {
     return {
-        .cell[0][0] = s.x,
-        .cell[0][1] = u.x,
-        .cell[0][2] = -f.x,
-        .cell[0][3] = 0.0f,
-        .cell[1][0] = s.y,
-        .cell[1][1] = u.y,
-        .cell[1][2] = -f.y,
-        .cell[1][3] = 0.0f,
-        .cell[2][0] = s.z,
-        .cell[2][1] = u.z,
-        .cell[2][2] = -f.z,
-        .cell[2][3] = 0.0f,
-        .cell[3][0] = -dot(s, eye),
-        .cell[3][1] = -dot(u, eye),
-        .cell[3][2] = dot(f, eye),
-        .cell[3][3] = 1.0f,
+        .cell[0][0] = x,
+        .cell[1][1] = x,
+        .cell[2][2] = x,
+        .cell[3][3] = x,
     };
 }
 
+static Mat4 translate(Vec3 a) {
+    Mat4 b = diag(1.0f);
+    b.cell[3][0] = a.x;
+    b.cell[3][1] = a.y;
+    b.cell[3][2] = a.z;
+    return b;
+}
+
+static Mat4 scale(Vec3 a) {
+    Mat4 b = diag(1.0f);
+    b.cell[0][0] = a.x;
+    b.cell[1][1] = a.y;
+    b.cell[2][2] = a.z;
+    return b;
+}
+
 #endif
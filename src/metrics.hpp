@@ -0,0 +1,111 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include "histogram.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// NOTE: Live metrics published into a POSIX shared-memory segment named
+// `/jmpr.<pid>`, for monitors that can't attach a debugger or scrape stdout.
+// Bump `METRICS_VERSION` whenever `MetricsData` changes shape; readers check
+// both it and `size` before trusting anything else.
+#define METRICS_VERSION 1
+#define METRICS_PASSES  6
+
+#define METRICS_CAP_NAME 32
+
+// NOTE: Durations are nanoseconds when `u64` and microseconds when `f32`.
+struct MetricsData {
+    u64              time;
+    u64              frames;
+    u64              missed;
+    u64              ticks;
+    u64              hash_queries;
+    u64              hash_candidates;
+    HistogramSummary frame;
+    HistogramSummary tick;
+    HistogramSummary sleep;
+    u64              frame_time;
+    f32              latency;
+    f32              scale;
+    f32              gpu_time;
+    f32              pass_time[METRICS_PASSES];
+    Vec3             position;
+    Vec3             speed;
+    Vec3             target;
+    u32              respawns;
+};
+
+// NOTE: Seqlock. The single writer makes `sequence` odd, copies `data` in,
+// then makes it even again; a reader retries whenever it sees an odd value
+// or the value changes under it. The writer never waits on anyone.
+struct Metrics {
+    u32         version;
+    u32         size;
+    u32         pid;
+    alignas(64) u64 sequence;
+    MetricsData data;
+};
+
+static Metrics* METRICS = null;
+static char     METRICS_NAME[METRICS_CAP_NAME];
+
+static void metrics_get_name(char* name, u32 pid) {
+    snprintf(name, METRICS_CAP_NAME, "/jmpr.%u", pid);
+}
+
+static void metrics_open() {
+    const u32 pid = static_cast<u32>(getpid());
+    metrics_get_name(METRICS_NAME, pid);
+    const i32 file = shm_open(METRICS_NAME, O_CREAT | O_RDWR, 0644);
+    EXIT_IF(file < 0);
+    EXIT_IF(ftruncate(file, sizeof(Metrics)));
+    void* address = mmap(null,
+                         sizeof(Metrics),
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED,
+                         file,
+                         0);
+    EXIT_IF(address == MAP_FAILED);
+    EXIT_IF(close(file));
+    METRICS = reinterpret_cast<Metrics*>(address);
+    METRICS->pid = pid;
+    METRICS->size = sizeof(Metrics);
+    __atomic_store_n(&METRICS->version, METRICS_VERSION, __ATOMIC_RELEASE);
+}
+
+static void metrics_publish(const MetricsData* data) {
+    const u64 sequence = METRICS->sequence;
+    __atomic_store_n(&METRICS->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&METRICS->data, data, sizeof(MetricsData));
+    __atomic_store_n(&METRICS->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+static void metrics_read(const Metrics* metrics, MetricsData* data) {
+    for (;;) {
+        const u64 sequence =
+            __atomic_load_n(&metrics->sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1) {
+            _mm_pause();
+            continue;
+        }
+        memcpy(data, &metrics->data, sizeof(MetricsData));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&metrics->sequence, __ATOMIC_RELAXED) ==
+            sequence)
+        {
+            return;
+        }
+    }
+}
+
+static void metrics_close() {
+    EXIT_IF(munmap(METRICS, sizeof(Metrics)));
+    EXIT_IF(shm_unlink(METRICS_NAME));
+    METRICS = null;
+}
+
+#endif
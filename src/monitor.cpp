@@ -0,0 +1,97 @@
+#include "metrics.hpp"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+// NOTE: Prints one consistent snapshot of a running instance's metrics, e.g.
+// `watch -n 1 bin/monitor $(pgrep main)`. Times are in milliseconds.
+
+static f64 get_milliseconds(u64 nanoseconds) {
+    return static_cast<f64>(nanoseconds) / NANOSECONDS_PER_MILLISECOND;
+}
+
+static void print_summary(const char* name, const HistogramSummary* summary) {
+    printf("%-16s%8u%10.3f%10.3f%10.3f%10.3f\n",
+           name,
+           summary->count,
+           get_milliseconds(summary->p50),
+           get_milliseconds(summary->p99),
+           get_milliseconds(summary->p999),
+           get_milliseconds(summary->max));
+}
+
+i32 main(i32 argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <pid>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    char name[METRICS_CAP_NAME];
+    metrics_get_name(name, static_cast<u32>(strtoul(argv[1], null, 10)));
+    const i32 file = shm_open(name, O_RDONLY, 0);
+    EXIT_IF(file < 0);
+    void* address =
+        mmap(null, sizeof(Metrics), PROT_READ, MAP_SHARED, file, 0);
+    EXIT_IF(address == MAP_FAILED);
+    EXIT_IF(close(file));
+    const Metrics* metrics = reinterpret_cast<const Metrics*>(address);
+    EXIT_IF(__atomic_load_n(&metrics->version, __ATOMIC_ACQUIRE) !=
+            METRICS_VERSION);
+    EXIT_IF(metrics->size != sizeof(Metrics));
+    MetricsData data;
+    metrics_read(metrics, &data);
+    printf("pid             %14u\n"
+           "time            %14.3f\n"
+           "frames          %14" PRIu64 "\n"
+           "missed          %14" PRIu64 "\n"
+           "ticks           %14" PRIu64 "\n"
+           "hash_queries    %14" PRIu64 "\n"
+           "hash_candidates %14" PRIu64 "\n"
+           "frame_time      %14.3f\n"
+           "latency         %14.3f\n"
+           "scale           %14.3f\n"
+           "gpu_time        %14.3f\n"
+           "pass_time       %10.3f%10.3f%10.3f%10.3f%10.3f%10.3f\n"
+           "position        %10.3f%10.3f%10.3f\n"
+           "speed           %10.3f%10.3f%10.3f\n"
+           "target          %10.3f%10.3f%10.3f\n"
+           "respawns        %14u\n",
+           metrics->pid,
+           get_milliseconds(data.time) / 1000.0,
+           data.frames,
+           data.missed,
+           data.ticks,
+           data.hash_queries,
+           data.hash_candidates,
+           get_milliseconds(data.frame_time),
+           static_cast<f64>(data.latency) / 1000.0,
+           static_cast<f64>(data.scale),
+           static_cast<f64>(data.gpu_time) / 1000.0,
+           static_cast<f64>(data.pass_time[0]) / 1000.0,
+           static_cast<f64>(data.pass_time[1]) / 1000.0,
+           static_cast<f64>(data.pass_time[2]) / 1000.0,
+           static_cast<f64>(data.pass_time[3]) / 1000.0,
+           static_cast<f64>(data.pass_time[4]) / 1000.0,
+           static_cast<f64>(data.pass_time[5]) / 1000.0,
+           static_cast<f64>(data.position.x),
+           static_cast<f64>(data.position.y),
+           static_cast<f64>(data.position.z),
+           static_cast<f64>(data.speed.x),
+           static_cast<f64>(data.speed.y),
+           static_cast<f64>(data.speed.z),
+           static_cast<f64>(data.target.x),
+           static_cast<f64>(data.target.y),
+           static_cast<f64>(data.target.z),
+           data.respawns);
+    printf("%16s%8s%10s%10s%10s%10s\n",
+           "",
+           "count",
+           "p50",
+           "p99",
+           "p99.9",
+           "max");
+    print_summary("frame", &data.frame);
+    print_summary("tick", &data.tick);
+    print_summary("sleep", &data.sleep);
+    EXIT_IF(munmap(address, sizeof(Metrics)));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,300 @@
+#ifndef __NET_H__
+#define __NET_H__
+
+#include "player.hpp"
+
+#include <string.h>
+
+// NOTE: Wire format shared by `bin/server` and its clients. Everything past
+// a packet's leading bytes is a `LEB128` varint, signed values zigzagged, so
+// nothing depends on struct layout or byte order.
+//   - Input (client to server): type, sequence, the newest snapshot the
+//     client has all of, keys, and the view direction.
+//   - Snapshot (server to client): the world at one tick, as deltas against
+//     a snapshot the client acknowledged (`baseline`), or against all zeroes
+//     when `baseline` is `0`. Split into fragments that each fit one
+//     `NET_CAP_PACKET` datagram and decode on their own; a snapshot counts as
+//     received once all of its fragments have been.
+// Players that match the baseline exactly are left out, and the rest only
+// carry the fields that changed.
+#define NET_PORT 7777
+
+#define NET_PACKET_INPUT    0
+#define NET_PACKET_SNAPSHOT 1
+
+#define NET_CAP_PACKET    1200
+#define NET_CAP_FRAGMENTS 64
+#define NET_CAP_PLAYERS   1024
+
+// NOTE: Positions to `1 / 256` of a unit and per-tick speeds to `1 / 65536`,
+// well under anything a player could see.
+#define NET_POSITION_SCALE 256.0f
+#define NET_SPEED_SCALE    65536.0f
+#define NET_VIEW_SCALE     1024.0f
+
+#define NET_FIELDS 6
+
+// NOTE: Longest encoding of one player: gap, mask, and every field.
+#define NET_CAP_ENTRY (5 + 1 + (NET_FIELDS * 5))
+
+// NOTE: type, fragment index, fragment count, then the varints.
+#define NET_SNAPSHOT_INDEX 1
+#define NET_SNAPSHOT_COUNT 2
+#define NET_SNAPSHOT_FIXED 3
+
+struct NetPlayer {
+    i32 fields[NET_FIELDS];
+};
+
+struct NetInput {
+    Vec3 view_target;
+    u32  sequence;
+    u32  ack;
+    u8   keys;
+};
+
+struct NetFragment {
+    u32 tick;
+    u32 baseline;
+    u32 len_players;
+    u8  index;
+    u8  count;
+};
+
+static u8* net_put_varint(u8* cursor, u32 value) {
+    while (0x80 <= value) {
+        *cursor++ = static_cast<u8>(value | 0x80);
+        value >>= 7;
+    }
+    *cursor++ = static_cast<u8>(value);
+    return cursor;
+}
+
+// NOTE: Returns `null` if the varint runs off `end` or past 32 bits.
+static const u8* net_get_varint(const u8* cursor, const u8* end, u32* value) {
+    *value = 0;
+    for (u32 shift = 0; shift < 35; shift += 7) {
+        if (cursor == end) {
+            return null;
+        }
+        const u8 byte = *cursor++;
+        *value |= static_cast<u32>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return cursor;
+        }
+    }
+    return null;
+}
+
+static u32 net_zigzag(i32 value) {
+    return (static_cast<u32>(value) << 1) ^ static_cast<u32>(value >> 31);
+}
+
+static i32 net_unzigzag(u32 value) {
+    return static_cast<i32>(value >> 1) ^ -static_cast<i32>(value & 1);
+}
+
+// NOTE: Wraps rather than overflows, and `net_get_field` undoes it exactly.
+static i32 net_get_delta(i32 value, i32 baseline) {
+    return static_cast<i32>(static_cast<u32>(value) -
+                            static_cast<u32>(baseline));
+}
+
+static i32 net_get_field(i32 baseline, i32 delta) {
+    return static_cast<i32>(static_cast<u32>(baseline) +
+                            static_cast<u32>(delta));
+}
+
+static i32 net_quantize(f32 value, f32 scale) {
+    return static_cast<i32>(lrintf(value * scale));
+}
+
+static NetPlayer net_get_player(const Player* player) {
+    return {{
+        net_quantize(player->position.x, NET_POSITION_SCALE),
+        net_quantize(player->position.y, NET_POSITION_SCALE),
+        net_quantize(player->position.z, NET_POSITION_SCALE),
+        net_quantize(player->speed.x, NET_SPEED_SCALE),
+        net_quantize(player->speed.y, NET_SPEED_SCALE),
+        net_quantize(player->speed.z, NET_SPEED_SCALE),
+    }};
+}
+
+static u32 net_put_input(u8* packet, const NetInput* input) {
+    u8* cursor = packet;
+    *cursor++ = NET_PACKET_INPUT;
+    cursor = net_put_varint(cursor, input->sequence);
+    cursor = net_put_varint(cursor, input->ack);
+    *cursor++ = input->keys;
+    cursor = net_put_varint(
+        cursor,
+        net_zigzag(net_quantize(input->view_target.x, NET_VIEW_SCALE)));
+    cursor = net_put_varint(
+        cursor,
+        net_zigzag(net_quantize(input->view_target.y, NET_VIEW_SCALE)));
+    cursor = net_put_varint(
+        cursor,
+        net_zigzag(net_quantize(input->view_target.z, NET_VIEW_SCALE)));
+    return static_cast<u32>(cursor - packet);
+}
+
+// NOTE: Anything malformed, including a view that isn't roughly unit length,
+// is refused as a whole.
+static bool net_get_input(const u8* packet, u32 size, NetInput* input) {
+    const u8* end = packet + size;
+    if ((size < 2) || (packet[0] != NET_PACKET_INPUT)) {
+        return false;
+    }
+    const u8* cursor = net_get_varint(packet + 1, end, &input->sequence);
+    if (!cursor || !(cursor = net_get_varint(cursor, end, &input->ack)) ||
+        (cursor == end))
+    {
+        return false;
+    }
+    input->keys = *cursor++;
+    f32 view[3];
+    for (u32 i = 0; i < 3; ++i) {
+        u32 value;
+        if (!(cursor = net_get_varint(cursor, end, &value))) {
+            return false;
+        }
+        view[i] = static_cast<f32>(net_unzigzag(value)) / NET_VIEW_SCALE;
+    }
+    input->view_target = {view[0], view[1], view[2]};
+    const f32 length = len(input->view_target);
+    return (cursor == end) && (0.5f < length) && (length < 1.5f);
+}
+
+// NOTE: Writes every fragment of `players` against `baseline` (`null` for
+// all zeroes) into `packets`, `NET_CAP_PACKET` bytes apart, and their sizes
+// into `sizes`; returns how many there are.
+static u8 net_put_snapshot(u8*              packets,
+                           u32*             sizes,
+                           const NetPlayer* players,
+                           const NetPlayer* baseline,
+                           u32              len_players,
+                           u32              tick,
+                           u32              baseline_tick) {
+    static const NetPlayer zero = {};
+    u8                     count = 0;
+    u8*                    packet = null;
+    u8*                    cursor = null;
+    u32                    next = 0;
+    for (u32 i = 0; i <= len_players; ++i) {
+        const bool last = i == len_players;
+        u8         mask = 0;
+        if (!last) {
+            const NetPlayer* base = baseline ? &baseline[i] : &zero;
+            for (u8 j = 0; j < NET_FIELDS; ++j) {
+                if (players[i].fields[j] != base->fields[j]) {
+                    mask |= static_cast<u8>(1 << j);
+                }
+            }
+            if (!mask) {
+                continue;
+            }
+        }
+        // NOTE: An empty snapshot still needs one fragment to acknowledge.
+        if ((!packet) ||
+            (!last && ((packet + NET_CAP_PACKET) < (cursor + NET_CAP_ENTRY))))
+        {
+            if (packet) {
+                sizes[count - 1] = static_cast<u32>(cursor - packet);
+            }
+            EXIT_IF(count == NET_CAP_FRAGMENTS);
+            packet = &packets[count * NET_CAP_PACKET];
+            packet[0] = NET_PACKET_SNAPSHOT;
+            packet[NET_SNAPSHOT_INDEX] = count++;
+            cursor = packet + NET_SNAPSHOT_FIXED;
+            cursor = net_put_varint(cursor, tick);
+            cursor = net_put_varint(cursor, baseline_tick);
+            cursor = net_put_varint(cursor, len_players);
+            cursor = net_put_varint(cursor, next);
+        }
+        if (last) {
+            break;
+        }
+        const NetPlayer* base = baseline ? &baseline[i] : &zero;
+        cursor = net_put_varint(cursor, i - next);
+        *cursor++ = mask;
+        for (u8 j = 0; j < NET_FIELDS; ++j) {
+            if (mask & (1 << j)) {
+                cursor = net_put_varint(
+                    cursor,
+                    net_zigzag(net_get_delta(players[i].fields[j],
+                                             base->fields[j])));
+            }
+        }
+        next = i + 1;
+    }
+    sizes[count - 1] = static_cast<u32>(cursor - packet);
+    for (u8 i = 0; i < count; ++i) {
+        packets[(i * NET_CAP_PACKET) + NET_SNAPSHOT_COUNT] = count;
+    }
+    return count;
+}
+
+// NOTE: Reads a fragment's header and returns where its players start, or
+// `null` if it isn't a well-formed snapshot fragment.
+static const u8* net_get_fragment(const u8*    packet,
+                                  u32          size,
+                                  NetFragment* fragment,
+                                  u32*         next) {
+    const u8* end = packet + size;
+    if ((size < NET_SNAPSHOT_FIXED) || (packet[0] != NET_PACKET_SNAPSHOT)) {
+        return null;
+    }
+    fragment->index = packet[NET_SNAPSHOT_INDEX];
+    fragment->count = packet[NET_SNAPSHOT_COUNT];
+    if ((fragment->count == 0) || (NET_CAP_FRAGMENTS < fragment->count) ||
+        (fragment->count <= fragment->index))
+    {
+        return null;
+    }
+    const u8* cursor = packet + NET_SNAPSHOT_FIXED;
+    if (!(cursor = net_get_varint(cursor, end, &fragment->tick)) ||
+        !(cursor = net_get_varint(cursor, end, &fragment->baseline)) ||
+        !(cursor = net_get_varint(cursor, end, &fragment->len_players)) ||
+        !(cursor = net_get_varint(cursor, end, next)) ||
+        (NET_CAP_PLAYERS < fragment->len_players))
+    {
+        return null;
+    }
+    return cursor;
+}
+
+// NOTE: Applies a fragment's players on top of `players`, which must already
+// hold the baseline. Returns `false` on anything malformed, possibly after
+// having applied part of it.
+static bool net_get_players(const u8* cursor,
+                            const u8* end,
+                            u32       next,
+                            u32       len_players,
+                            NetPlayer* players) {
+    while (cursor != end) {
+        u32 gap;
+        if (!(cursor = net_get_varint(cursor, end, &gap)) || (cursor == end)) {
+            return false;
+        }
+        const u32 index = next + gap;
+        if ((index < next) || (len_players <= index)) {
+            return false;
+        }
+        const u8 mask = *cursor++;
+        for (u8 j = 0; j < NET_FIELDS; ++j) {
+            if (!(mask & (1 << j))) {
+                continue;
+            }
+            u32 delta;
+            if (!(cursor = net_get_varint(cursor, end, &delta))) {
+                return false;
+            }
+            players[index].fields[j] =
+                net_get_field(players[index].fields[j], net_unzigzag(delta));
+        }
+        next = index + 1;
+    }
+    return true;
+}
+
+#endif
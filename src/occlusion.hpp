@@ -0,0 +1,262 @@
+#ifndef __OCCLUSION_H__
+#define __OCCLUSION_H__
+
+#include "bind.hpp"
+#include "init.hpp"
+#include "init_assets_codegen.hpp"
+#include "math.hpp"
+#include "scene_assets.hpp"
+
+#include <stddef.h>
+
+// NOTE: Two-phase `Hi-Z` occlusion culling, entirely on the GPU so nothing is
+// ever read back. Phase `0` draws the instances that were visible last frame;
+// their depth is reduced into a max-depth mip chain, every instance's bounds
+// are tested against it via transform feedback, and phase `1` draws whatever
+// has just become visible. Sticks to GL 3.3 so it runs under `llvmpipe`.
+struct Occlusion {
+    u32 program_hiz;
+    u32 program_cull;
+    i32 uniform_cull_levels;
+    u32 vertex_array_hiz;
+    u32 vertex_array_cull;
+    u32 bounds_buffer;
+    u32 visible_buffer;
+    u32 visible_prev_buffer;
+    u32 frame_buffer;
+    u32 texture;
+    i32 width;
+    i32 height;
+    i32 levels;
+    u32 len_bounds;
+};
+
+static Occlusion OCCLUSION;
+
+#define INDEX_BOTTOM_LEFT_FRONT 0
+#define INDEX_TOP_RIGHT_BACK    1
+
+template <usize N>
+static void occlusion_set_programs(BufferMemory<N>* memory, Arena* arena) {
+    OCCLUSION.program_hiz = init_get_program_cached(memory,
+                                                    arena,
+                                                    SHADER_HIZ_VERT,
+                                                    SHADER_HIZ_FRAG,
+                                                    null);
+    OCCLUSION.program_cull = init_get_program_cached(memory,
+                                                     arena,
+                                                     SHADER_CULL_VERT,
+                                                     null,
+                                                     "CULL_OUT_VISIBLE");
+    init_set_uniform_block(OCCLUSION.program_cull,
+                           "FRAME",
+                           INIT_BINDING_FRAME);
+    OCCLUSION.uniform_cull_levels =
+        glGetUniformLocation(OCCLUSION.program_cull, "LEVELS");
+    CHECK_GL_ERROR();
+}
+
+static void occlusion_set_visible_buffer(u32* buffer) {
+    glGenBuffers(1, buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, *buffer);
+    glBufferData(GL_ARRAY_BUFFER,
+                 static_cast<i64>(sizeof(f32) * OCCLUSION.len_bounds),
+                 null,
+                 GL_DYNAMIC_COPY);
+    // NOTE: Everything starts out visible; the first frame draws it all in
+    // phase `0` and lets the test sort it out.
+    f32* visible =
+        reinterpret_cast<f32*>(glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY));
+    EXIT_IF(!visible);
+    for (u32 i = 0; i < OCCLUSION.len_bounds; ++i) {
+        visible[i] = 1.0f;
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+static void occlusion_set_buffers(const Cube* bounds, u32 len_bounds) {
+    OCCLUSION.len_bounds = len_bounds;
+    occlusion_set_visible_buffer(&OCCLUSION.visible_buffer);
+    occlusion_set_visible_buffer(&OCCLUSION.visible_prev_buffer);
+    CHECK_GL_ERROR();
+    {
+        glGenVertexArrays(1, &OCCLUSION.vertex_array_cull);
+        bind_vertex_array(OCCLUSION.vertex_array_cull);
+        glGenBuffers(1, &OCCLUSION.bounds_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, OCCLUSION.bounds_buffer);
+        glBufferData(GL_ARRAY_BUFFER,
+                     static_cast<i64>(sizeof(Cube) * len_bounds),
+                     bounds,
+                     GL_STATIC_DRAW);
+        glEnableVertexAttribArray(INDEX_BOTTOM_LEFT_FRONT);
+        glVertexAttribPointer(INDEX_BOTTOM_LEFT_FRONT,
+                              3,
+                              GL_FLOAT,
+                              false,
+                              sizeof(Cube),
+                              null);
+        glEnableVertexAttribArray(INDEX_TOP_RIGHT_BACK);
+        glVertexAttribPointer(
+            INDEX_TOP_RIGHT_BACK,
+            3,
+            GL_FLOAT,
+            false,
+            sizeof(Cube),
+            reinterpret_cast<void*>(offsetof(Cube, top_right_back)));
+        CHECK_GL_ERROR();
+    }
+    {
+        // NOTE: The full-screen triangle pulls nothing, but core profile
+        // still wants a vertex array bound.
+        glGenVertexArrays(1, &OCCLUSION.vertex_array_hiz);
+        CHECK_GL_ERROR();
+    }
+    {
+        glGenFramebuffers(1, &OCCLUSION.frame_buffer);
+        CHECK_GL_ERROR();
+    }
+}
+
+static void occlusion_set_bounds(u32 first, const Cube* bounds, u32 len) {
+    glBindBuffer(GL_ARRAY_BUFFER, OCCLUSION.bounds_buffer);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    static_cast<i64>(sizeof(Cube) * first),
+                    static_cast<i64>(sizeof(Cube) * len),
+                    bounds);
+}
+
+// NOTE: Rebuilt from scratch whenever the off-screen resolution changes; the
+// level count changes with it and stale levels must not linger.
+static void occlusion_set_texture(i32 width, i32 height) {
+    if (OCCLUSION.texture) {
+        glDeleteTextures(1, &OCCLUSION.texture);
+        bind_reset();
+    }
+    {
+        // NOTE: Level `0` is already half the off-screen resolution; each
+        // level stores the farthest depth of the texels below it.
+        OCCLUSION.width = MAX(width / 2, 1);
+        OCCLUSION.height = MAX(height / 2, 1);
+        glGenTextures(1, &OCCLUSION.texture);
+        bind_texture(OCCLUSION.texture);
+        i32 level_width = OCCLUSION.width;
+        i32 level_height = OCCLUSION.height;
+        OCCLUSION.levels = 0;
+        for (;;) {
+            glTexImage2D(GL_TEXTURE_2D,
+                         OCCLUSION.levels++,
+                         GL_R32F,
+                         level_width,
+                         level_height,
+                         0,
+                         GL_RED,
+                         GL_FLOAT,
+                         null);
+            if ((level_width == 1) && (level_height == 1)) {
+                break;
+            }
+            level_width = MAX(level_width / 2, 1);
+            level_height = MAX(level_height / 2, 1);
+        }
+        glTexParameteri(GL_TEXTURE_2D,
+                        GL_TEXTURE_MIN_FILTER,
+                        GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D,
+                        GL_TEXTURE_MAX_LEVEL,
+                        OCCLUSION.levels - 1);
+        CHECK_GL_ERROR();
+    }
+    {
+        bind_frame_buffer(OCCLUSION.frame_buffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D,
+                               OCCLUSION.texture,
+                               0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+            GL_FRAMEBUFFER_COMPLETE)
+        {
+            CHECK_GL_ERROR();
+        }
+        bind_frame_buffer(0);
+        CHECK_GL_ERROR();
+    }
+    bind_program(OCCLUSION.program_cull);
+    glUniform1i(OCCLUSION.uniform_cull_levels, OCCLUSION.levels);
+    CHECK_GL_ERROR();
+}
+
+static void occlusion_set_hiz(u32 texture_depth) {
+    bind_program(OCCLUSION.program_hiz);
+    bind_vertex_array(OCCLUSION.vertex_array_hiz);
+    bind_frame_buffer(OCCLUSION.frame_buffer);
+    bind_texture(texture_depth);
+    i32 width = OCCLUSION.width;
+    i32 height = OCCLUSION.height;
+    for (i32 level = 0; level < OCCLUSION.levels; ++level) {
+        if (level != 0) {
+            // NOTE: Expose only the previous level for reading so the level
+            // being written never forms a feedback loop.
+            bind_texture(OCCLUSION.texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D,
+                               OCCLUSION.texture,
+                               level);
+        bind_viewport(width, height);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        width = MAX(width / 2, 1);
+        height = MAX(height / 2, 1);
+    }
+    bind_texture(OCCLUSION.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, OCCLUSION.levels - 1);
+}
+
+static void occlusion_set_visible() {
+    bind_program(OCCLUSION.program_cull);
+    bind_vertex_array(OCCLUSION.vertex_array_cull);
+    bind_texture(OCCLUSION.texture);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER,
+                     0,
+                     OCCLUSION.visible_buffer);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, static_cast<i32>(OCCLUSION.len_bounds));
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+}
+
+// NOTE: This frame's result becomes next frame's phase `0` set.
+static void occlusion_swap_visible() {
+    glBindBuffer(GL_COPY_READ_BUFFER, OCCLUSION.visible_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, OCCLUSION.visible_prev_buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        0,
+                        0,
+                        static_cast<i64>(sizeof(f32) * OCCLUSION.len_bounds));
+}
+
+static void occlusion_delete_buffers() {
+    glDeleteVertexArrays(1, &OCCLUSION.vertex_array_hiz);
+    glDeleteVertexArrays(1, &OCCLUSION.vertex_array_cull);
+    glDeleteBuffers(1, &OCCLUSION.bounds_buffer);
+    glDeleteBuffers(1, &OCCLUSION.visible_buffer);
+    glDeleteBuffers(1, &OCCLUSION.visible_prev_buffer);
+    glDeleteFramebuffers(1, &OCCLUSION.frame_buffer);
+    glDeleteTextures(1, &OCCLUSION.texture);
+}
+
+static void occlusion_delete_programs() {
+    glDeleteProgram(OCCLUSION.program_hiz);
+    glDeleteProgram(OCCLUSION.program_cull);
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef __PACING_H__
+#define __PACING_H__
+
+#include "prelude.hpp"
+
+#include <errno.h>
+#include <time.h>
+
+#define NANOSECONDS 1000000000lu
+
+// NOTE: Sleeping is only trusted up to this close to a deadline; the rest is
+// spent spinning so the wake-up doesn't depend on scheduler slop.
+#define PACING_SPIN (NANOSECONDS / 1000lu)
+
+#define PACING_HISTORY (1 << 8)
+
+struct PacingRecord {
+    u64 deadline;
+    u64 end;
+};
+
+struct Pacing {
+    u64          start;
+    u64          period;
+    u64          deadline;
+    u64          frames;
+    u64          missed;
+    PacingRecord history[PACING_HISTORY];
+};
+
+static Pacing PACING;
+
+// NOTE: Integer nanoseconds from `CLOCK_MONOTONIC`; unlike `f32` seconds this
+// doesn't lose resolution as uptime grows.
+static u64 pacing_now() {
+    timespec time;
+    EXIT_IF(clock_gettime(CLOCK_MONOTONIC, &time));
+    return (static_cast<u64>(time.tv_sec) * NANOSECONDS) +
+           static_cast<u64>(time.tv_nsec);
+}
+
+// NOTE: Signed difference, for jitter and latency statistics.
+static f32 pacing_get_microseconds(u64 a, u64 b) {
+    return static_cast<f32>(static_cast<i64>(a - b)) / 1000.0f;
+}
+
+static void pacing_sleep_until(u64 deadline) {
+    const timespec time = {
+        static_cast<time_t>(deadline / NANOSECONDS),
+        static_cast<long>(deadline % NANOSECONDS),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, null) ==
+           EINTR)
+    {
+    }
+}
+
+static void pacing_wait_until(u64 deadline) {
+    if (PACING_SPIN < deadline) {
+        const u64 now = pacing_now();
+        if (now < (deadline - PACING_SPIN)) {
+            pacing_sleep_until(deadline - PACING_SPIN);
+        }
+    }
+    while (pacing_now() < deadline) {
+        _mm_pause();
+    }
+}
+
+// NOTE: A `rate` of `0` leaves frames unpaced; they start as soon as the last
+// one ends and none count as missed.
+static void pacing_set(u64 rate) {
+    PACING.start = pacing_now();
+    PACING.period = rate ? NANOSECONDS / rate : 0;
+    PACING.deadline = PACING.start;
+    PACING.frames = 0;
+    PACING.missed = 0;
+}
+
+// NOTE: Blocks until the current frame is due and returns its start time.
+// Frames are scheduled on a fixed cadence from `start`; if one overruns by
+// more than a whole period the schedule restarts from now instead of
+// bursting to catch up.
+static u64 pacing_begin() {
+    pacing_wait_until(PACING.deadline);
+    const u64 now = pacing_now();
+    if ((PACING.deadline + PACING.period) < now) {
+        PACING.deadline = now;
+    }
+    PACING.deadline += PACING.period;
+    return now;
+}
+
+static void pacing_end() {
+    const u64     end = pacing_now();
+    PacingRecord* record = &PACING.history[PACING.frames % PACING_HISTORY];
+    record->deadline = PACING.deadline;
+    record->end = end;
+    if (PACING.period && (PACING.deadline < end)) {
+        ++PACING.missed;
+    }
+    ++PACING.frames;
+}
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef __PLAYER_H__
+#define __PLAYER_H__
+
+#include "spatial_hash.hpp"
+#include "trace.hpp"
+
+struct Player {
+    Vec3 position;
+    Vec3 speed;
+    u32  respawns;
+    bool can_jump;
+    bool jump_key_released;
+};
+
+#define INPUT_KEY_W     (1 << 0)
+#define INPUT_KEY_A     (1 << 1)
+#define INPUT_KEY_S     (1 << 2)
+#define INPUT_KEY_D     (1 << 3)
+#define INPUT_KEY_SPACE (1 << 4)
+
+// NOTE: The simulation's view of the keyboard and view direction, rebuilt
+// every tick from `INPUT_QUEUE`; see `input.hpp`.
+struct Input {
+    Vec3 view_target;
+    u64  time;
+    u8   keys;
+};
+
+#define RUN      0.00325f
+#define FRICTION 0.96f
+#define DRAG     0.99f
+
+#define SPEED_MAX         0.125f
+#define SPEED_EPSILON     0.0001f
+#define SPEED_MAX_SQUARED (SPEED_MAX * SPEED_MAX)
+
+#define WORLD_Y_MIN -20.0f
+
+#define JUMP    0.0585f
+#define GRAVITY 0.000345f
+
+// NOTE: Apex of a standing jump, and how far a jump covers at `SPEED_MAX`
+// before landing back at its starting height. `DRAG` only ever shortens
+// either, so level generators should keep a healthy margin below both.
+#define JUMP_HEIGHT   ((JUMP * JUMP) / (2.0f * GRAVITY))
+#define JUMP_DISTANCE (SPEED_MAX * ((2.0f * JUMP) / GRAVITY))
+
+#define INIT_PLAYER_POSITION \
+    ((Vec3){                 \
+        -7.5f,               \
+        35.0f,               \
+        17.5f,               \
+    })
+
+#define PLAYER_WIDTH  1.5f
+#define PLAYER_HEIGHT 4.0f
+#define PLAYER_DEPTH  1.5f
+
+#define PLAYER_WIDTH_HALF (PLAYER_WIDTH / 2.0f)
+#define PLAYER_DEPTH_HALF (PLAYER_DEPTH / 2.0f)
+
+#define VIEW_UP                                     \
+    ((Vec3){                                        \
+        0.0f, /* NOTE: `x`-axis is left/right.   */ \
+        1.0f, /* NOTE: `y`-axis is down/up.      */ \
+        0.0f, /* NOTE: `z`-axis is forward/back. */ \
+    })
+
+#define NORM_CROSS(a, b) norm(cross(a, b))
+
+// NOTE: Runs on the simulation thread; the view itself belongs to the render
+// thread, which resets it once it sees `respawns` change.
+static void set_player(Player* player) {
+    player->position = INIT_PLAYER_POSITION;
+    player->speed = {};
+    player->can_jump = false;
+    player->jump_key_released = false;
+    ++player->respawns;
+}
+
+static void set_speed(const Input* input, Player* player) {
+    const Vec3 view_target = input->view_target;
+    if (input->keys & INPUT_KEY_W) {
+        player->speed -=
+            NORM_CROSS(cross(view_target, VIEW_UP), VIEW_UP) * RUN;
+    }
+    if (input->keys & INPUT_KEY_D) {
+        player->speed += NORM_CROSS(view_target, VIEW_UP) * RUN;
+    }
+    if (input->keys & INPUT_KEY_S) {
+        player->speed +=
+            NORM_CROSS(cross(view_target, VIEW_UP), VIEW_UP) * RUN;
+    }
+    if (input->keys & INPUT_KEY_A) {
+        player->speed -= NORM_CROSS(view_target, VIEW_UP) * RUN;
+    }
+    if ((input->keys & INPUT_KEY_SPACE) && (player->can_jump)) {
+        player->speed.y += JUMP;
+        player->can_jump = false;
+        player->jump_key_released = false;
+    }
+    if (!(input->keys & INPUT_KEY_SPACE)) {
+        player->jump_key_released = true;
+    }
+}
+
+// NOTE: Deterministic stand-in for recorded play, indexed by tick: mostly
+// forward, strafing in bursts, sweeping the view back and forth, and jumping
+// for 24 ticks out of every 480 (about once a second).
+static Input get_scripted_input(u64 tick) {
+    const u64 phase = tick & ((1lu << 10) - 1lu);
+    const f32 sweep =
+        static_cast<f32>(phase < (1lu << 9) ? phase : (1lu << 10) - phase);
+    const f32 yaw = get_radians(-90.0f + (sweep * 0.25f));
+    Input     input = {
+        {
+            cosf(yaw),
+            0.0f,
+            sinf(yaw),
+        },
+        0,
+        INPUT_KEY_W,
+    };
+    if ((tick & (1lu << 7)) && (tick & (1lu << 8))) {
+        input.keys |= INPUT_KEY_A;
+    } else if (tick & (1lu << 7)) {
+        input.keys |= INPUT_KEY_D;
+    }
+    if ((tick % 480) < 24) {
+        input.keys |= INPUT_KEY_SPACE;
+    }
+    return input;
+}
+
+static Cube get_cube_below(Player player) {
+    const f32 bottom = player.position.y - PLAYER_HEIGHT;
+    return {
+        {
+            player.position.x - PLAYER_WIDTH_HALF,
+            bottom + player.speed.y,
+            player.position.z - PLAYER_DEPTH_HALF,
+        },
+        {
+            player.position.x + PLAYER_WIDTH_HALF,
+            bottom,
+            player.position.z + PLAYER_DEPTH_HALF,
+        },
+    };
+}
+
+static Cube get_cube_above(Player player) {
+    return {
+        {
+            player.position.x - PLAYER_WIDTH_HALF,
+            player.position.y,
+            player.position.z - PLAYER_DEPTH_HALF,
+        },
+        {
+            player.position.x + PLAYER_WIDTH_HALF,
+            player.position.y + player.speed.y,
+            player.position.z + PLAYER_DEPTH_HALF,
+        },
+    };
+}
+
+static Cube get_cube_front(Player player) {
+    const Vec3 top_right_back = {
+        player.position.x + PLAYER_WIDTH_HALF,
+        player.position.y,
+        player.position.z - PLAYER_DEPTH_HALF,
+    };
+    return {
+        {
+            player.position.x - PLAYER_WIDTH_HALF,
+            player.position.y - PLAYER_HEIGHT,
+            top_right_back.z + player.speed.z,
+        },
+        top_right_back,
+    };
+}
+
+static Cube get_cube_back(Player player) {
+    const Vec3 bottom_left_front = {
+        player.position.x - PLAYER_WIDTH_HALF,
+        player.position.y - PLAYER_HEIGHT,
+        player.position.z + PLAYER_DEPTH_HALF,
+    };
+    return {
+        bottom_left_front,
+        {
+            player.position.x + PLAYER_WIDTH_HALF,
+            player.position.y,
+            bottom_left_front.z + player.speed.z,
+        },
+    };
+}
+
+static Cube get_cube_left(Player player) {
+    const Vec3 top_right_back = {
+        player.position.x - PLAYER_WIDTH_HALF,
+        player.position.y,
+        player.position.z + PLAYER_DEPTH_HALF,
+    };
+    return {
+        {
+            top_right_back.x + player.speed.x,
+            player.position.y - PLAYER_HEIGHT,
+            player.position.z - PLAYER_DEPTH_HALF,
+        },
+        top_right_back,
+    };
+}
+
+static Cube get_cube_right(Player player) {
+    const Vec3 bottom_left_front = {
+        player.position.x + PLAYER_WIDTH_HALF,
+        player.position.y - PLAYER_HEIGHT,
+        player.position.z - PLAYER_DEPTH_HALF,
+    };
+    return {
+        bottom_left_front,
+        {
+            bottom_left_front.x + player.speed.x,
+            player.position.y,
+            player.position.z + PLAYER_DEPTH_HALF,
+        },
+    };
+}
+
+#define INTERSECT_PLAYER_PLATFORM(player, platform)              \
+    ((player.bottom_left_front.x < platform.top_right_back.x) && \
+     (platform.bottom_left_front.x < player.top_right_back.x) && \
+     (player.bottom_left_front.y < platform.top_right_back.y) && \
+     (platform.bottom_left_front.y < player.top_right_back.y) && \
+     (player.bottom_left_front.z < platform.top_right_back.z) && \
+     (platform.bottom_left_front.z < player.top_right_back.z))
+
+#define WITHIN_SPEED_EPSILON(x) \
+    ((-SPEED_EPSILON < (x)) && ((x) < SPEED_EPSILON))
+
+static void set_motion(GridMemory* memory, Player* player) {
+    TRACE_SCOPE("set_motion");
+    if (player->position.y < WORLD_Y_MIN) {
+        set_player(player);
+        return;
+    }
+    player->speed.y -= GRAVITY;
+    player->can_jump = false;
+    f32 x_speed = player->speed.x * DRAG;
+    f32 z_speed = player->speed.z * DRAG;
+    if (player->speed.y <= 0.0f) {
+        const Cube below = get_cube_below(*player);
+        player->position.y += player->speed.y;
+        hash_set_intersects(memory, &below);
+        for (u32 i = 0; i < memory->len_intersects; ++i) {
+            if (INTERSECT_PLAYER_PLATFORM(below, (*memory->intersects[i]))) {
+                player->position.y =
+                    memory->intersects[i]->top_right_back.y + PLAYER_HEIGHT;
+                player->speed.y = 0.0f;
+                x_speed = player->speed.x * FRICTION;
+                z_speed = player->speed.z * FRICTION;
+                if (player->jump_key_released) {
+                    player->can_jump = true;
+                }
+                break;
+            }
+        }
+    } else {
+        const Cube above = get_cube_above(*player);
+        player->position.y += player->speed.y;
+        hash_set_intersects(memory, &above);
+        for (u32 i = 0; i < memory->len_intersects; ++i) {
+            if (INTERSECT_PLAYER_PLATFORM(above, (*memory->intersects[i]))) {
+                player->position.y =
+                    memory->intersects[i]->bottom_left_front.y;
+                player->speed.y = 0.0f;
+                break;
+            }
+        }
+    }
+    if (SPEED_MAX_SQUARED < ((x_speed * x_speed) + (z_speed * z_speed))) {
+        const f32 radians = atan2f(z_speed, x_speed);
+        player->speed.x = SPEED_MAX * cosf(radians);
+        player->speed.z = SPEED_MAX * sinf(radians);
+    } else {
+        player->speed.x = x_speed;
+        player->speed.z = z_speed;
+    }
+    player->position.y += GRAVITY;
+    const Cube front_back = player->speed.z < 0.0f
+                                ? get_cube_front(*player)
+                                : get_cube_back(*player);
+    const Cube left_right = player->speed.x < 0.0f
+                                ? get_cube_left(*player)
+                                : get_cube_right(*player);
+    player->position.y -= GRAVITY;
+    if (WITHIN_SPEED_EPSILON(player->speed.x)) {
+        player->speed.x = 0.0f;
+    } else {
+        player->position.x += player->speed.x;
+    }
+    if (WITHIN_SPEED_EPSILON(player->speed.z)) {
+        player->speed.z = 0.0f;
+    } else {
+        player->position.z += player->speed.z;
+    }
+    hash_set_intersects(memory, &front_back);
+    for (u32 i = 0; i < memory->len_intersects; ++i) {
+        if (INTERSECT_PLAYER_PLATFORM(front_back, (*memory->intersects[i]))) {
+            player->position.z -= player->speed.z;
+            player->speed.z = 0.0f;
+        }
+    }
+    hash_set_intersects(memory, &left_right);
+    for (u32 i = 0; i < memory->len_intersects; ++i) {
+        if (INTERSECT_PLAYER_PLATFORM(left_right, (*memory->intersects[i]))) {
+            player->position.x -= player->speed.x;
+            player->speed.x = 0.0f;
+        }
+    }
+}
+
+#endif
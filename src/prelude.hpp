@@ -4,16 +4,21 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <xmmintrin.h>
 
 #define PI 3.1415926535897932385f
 
 typedef uint8_t  u8;
+typedef uint16_t u16;
 typedef uint32_t u32;
+typedef uint64_t u64;
 typedef size_t   usize;
 
 typedef int32_t i32;
+typedef int64_t i64;
+typedef ssize_t isize;
 
 typedef float  f32;
 typedef double f64;
@@ -28,6 +33,11 @@ struct Vec3 {
     f32 z;
 };
 
+union Vec4 {
+    f32      cell[4];
+    Simd4f32 simd;
+};
+
 union Mat4 {
     f32      cell[4][4];
     Simd4f32 column[4];
@@ -55,4 +65,14 @@ struct Cube {
         EXIT_WITH(#condition) \
     }
 
+// NOTE: The value following `flag` on the command line, if any.
+static const char* get_arg(i32 argc, char** argv, const char* flag) {
+    for (i32 i = 1; i < (argc - 1); ++i) {
+        if (!strcmp(argv[i], flag)) {
+            return argv[i + 1];
+        }
+    }
+    return null;
+}
+
 #endif
@@ -0,0 +1,478 @@
+#ifndef __REACH_H__
+#define __REACH_H__
+
+#include "player.hpp"
+
+#include <pthread.h>
+
+// NOTE: Which platform a player can get to from which. A pair counts only if
+// `set_speed` and `set_motion` themselves carry a player across: from the
+// edge of one platform nearest the other, already at `SPEED_MAX`, heading
+// straight for the other's centre and braking in time to stop there, either
+// jumping or walking off. Nothing cleverer is tried (turning mid-air,
+// taking off anywhere else), so the graph errs towards missing a route
+// rather than inventing one.
+//
+// Simulating every pair is quadratic, so the grid first narrows each
+// platform's candidates to those a flight of that height could cover at all;
+// only those are simulated, spread over every core. The result is a `CSR`
+// graph: platform `i`'s edges are `edges[offsets[i]]` through
+// `edges[offsets[i + 1] - 1]`, in increasing order of target.
+//
+// `cost` is in ticks and never undercuts the horizontal distance between the
+// two platforms' centres at `SPEED_MAX`, which keeps the `A*` heuristic in
+// `reach_find_paths` consistent.
+#define REACH_DROP        20.0f
+#define REACH_MARGIN      16.0f
+#define REACH_EPSILON     0.001f
+#define REACH_CAP_THREADS 64
+#define REACH_BATCH       8
+
+struct ReachEdge {
+    u32 platform;
+    f32 cost;
+};
+
+struct Reach {
+    const u32*       offsets;
+    const ReachEdge* edges;
+    u32              len_platforms;
+    u32              len_edges;
+};
+
+// NOTE: `cost` is `-1` when no attempt lands.
+struct ReachBuild {
+    const u32* offsets;
+    const u32* candidates;
+    f32*       costs;
+    u32        len_platforms;
+    u32        next;
+};
+
+struct ReachWorker {
+    GridMemory  grid;
+    ReachBuild* build;
+    pthread_t   thread;
+};
+
+struct ReachQuery {
+    u32 from;
+    u32 to;
+};
+
+// NOTE: `len` is `0` when `to` can't be reached from `from`.
+struct ReachPath {
+    const u32* platforms;
+    u32        len;
+    f32        cost;
+};
+
+struct ReachNode {
+    f32 estimate;
+    u32 platform;
+};
+
+static Vec3 reach_get_center(const Cube* cube) {
+    Vec3 center = (cube->bottom_left_front + cube->top_right_back) / 2.0f;
+    center.y = 0.0f;
+    return center;
+}
+
+static Vec3 reach_clip(Vec3 point, const Cube* cube) {
+    return {
+        MIN(MAX(point.x, cube->bottom_left_front.x), cube->top_right_back.x),
+        0.0f,
+        MIN(MAX(point.z, cube->bottom_left_front.z), cube->top_right_back.z),
+    };
+}
+
+// NOTE: Longest flight, in ticks, that lands `height` above where it took
+// off; `height` is negative for drops.
+static f32 reach_get_ticks(f32 height) {
+    return (JUMP / GRAVITY) +
+           sqrtf((2.0f * (JUMP_HEIGHT - height)) / GRAVITY) + REACH_MARGIN;
+}
+
+static f32 reach_get_gap(const Cube* from, const Cube* to) {
+    const f32 x = MAX(0.0f,
+                      MAX(to->bottom_left_front.x - from->top_right_back.x,
+                          from->bottom_left_front.x - to->top_right_back.x));
+    const f32 z = MAX(0.0f,
+                      MAX(to->bottom_left_front.z - from->top_right_back.z,
+                          from->bottom_left_front.z - to->top_right_back.z));
+    return sqrtf((x * x) + (z * z));
+}
+
+static bool reach_is_candidate(const Cube* from, const Cube* to) {
+    const f32 height = to->top_right_back.y - from->top_right_back.y;
+    if ((JUMP_HEIGHT < height) || (height < -REACH_DROP)) {
+        return false;
+    }
+    return reach_get_gap(from, to) <=
+           ((SPEED_MAX * reach_get_ticks(height)) + PLAYER_WIDTH);
+}
+
+// NOTE: Everything a candidate could be; `reach_is_candidate` has the final
+// say.
+static Cube reach_get_bounds(const Cube* from) {
+    const f32 extent =
+        (SPEED_MAX * reach_get_ticks(-REACH_DROP)) + PLAYER_WIDTH;
+    return {
+        {
+            from->bottom_left_front.x - extent,
+            from->top_right_back.y - REACH_DROP,
+            from->bottom_left_front.z - extent,
+        },
+        {
+            from->top_right_back.x + extent,
+            from->top_right_back.y + JUMP_HEIGHT,
+            from->top_right_back.z + extent,
+        },
+    };
+}
+
+// NOTE: `set_motion` lands a player against where they stood before the
+// tick's horizontal move, so that is the `x` and `z` to pass here.
+static bool reach_is_standing(Vec3 position, const Cube* platform) {
+    return (fabsf((position.y - PLAYER_HEIGHT) - platform->top_right_back.y) <
+            REACH_EPSILON) &&
+           (platform->bottom_left_front.x <
+            (position.x + PLAYER_WIDTH_HALF)) &&
+           ((position.x - PLAYER_WIDTH_HALF) < platform->top_right_back.x) &&
+           (platform->bottom_left_front.z <
+            (position.z + PLAYER_DEPTH_HALF)) &&
+           ((position.z - PLAYER_DEPTH_HALF) < platform->top_right_back.z);
+}
+
+// NOTE: Forward until a stop from the current speed would end at `aim`, then
+// back, as a player lining up a landing would; along `direction` only.
+static u8 reach_get_keys(const Player* player, Vec3 aim, Vec3 direction) {
+    const Vec3 position = {player->position.x, 0.0f, player->position.z};
+    const Vec3 speed = {player->speed.x, 0.0f, player->speed.z};
+    const f32  remaining = dot(aim - position, direction);
+    const f32  along = dot(speed, direction);
+    if (((along * along) / (2.0f * RUN)) < remaining) {
+        return INPUT_KEY_W;
+    }
+    return 0.0f < along ? static_cast<u8>(INPUT_KEY_S) : 0;
+}
+
+// NOTE: Returns the cost of one attempt, or `-1` if it lands anywhere but
+// `to` once airborne (including back on `from`), stalls, falls too far, or
+// runs out of ticks.
+static f32 reach_get_attempt(GridMemory* memory,
+                             const Cube* from,
+                             const Cube* to,
+                             Vec3        launch,
+                             Vec3        direction,
+                             bool        jump) {
+    Player player = {};
+    player.position = {
+        launch.x,
+        from->top_right_back.y + PLAYER_HEIGHT,
+        launch.z,
+    };
+    player.speed = direction * SPEED_MAX;
+    player.can_jump = true;
+    player.jump_key_released = true;
+    const Vec3 aim = reach_get_center(to);
+    Input      input = {direction, 0, 0};
+    const f32  height = to->top_right_back.y - from->top_right_back.y;
+    const u32  ticks = static_cast<u32>(reach_get_ticks(height));
+    bool       airborne = false;
+    for (u32 i = 0; i < ticks; ++i) {
+        input.keys = reach_get_keys(&player, aim, direction);
+        if (jump && (i == 0)) {
+            input.keys |= INPUT_KEY_SPACE;
+        }
+        set_speed(&input, &player);
+        const Vec3 before = player.position;
+        set_motion(memory, &player);
+        if (player.respawns != 0) {
+            return -1.0f;
+        }
+        if (!player.can_jump) {
+            airborne = true;
+            continue;
+        }
+        if (reach_is_standing({before.x, player.position.y, before.z}, to)) {
+            const Vec3 landing = {before.x, 0.0f, before.z};
+            return static_cast<f32>(i + 1) +
+                   ((len(launch - reach_get_center(from)) +
+                     len(landing - aim)) /
+                    SPEED_MAX);
+        }
+        // NOTE: Until it leaves the ground, a walk may cross whatever is
+        // level with `from`.
+        if (airborne || ((fabsf(player.speed.x) < REACH_EPSILON) &&
+                         (fabsf(player.speed.z) < REACH_EPSILON)))
+        {
+            return -1.0f;
+        }
+    }
+    return -1.0f;
+}
+
+// NOTE: Takes off from the point of `from` nearest `to`, heading for the
+// centre of `to`, either jumping or walking off; returns the cheaper attempt
+// that lands.
+static f32 reach_get_cost(GridMemory* memory,
+                          const Cube* from,
+                          const Cube* to) {
+    const Vec3 launch =
+        reach_clip(reach_clip(reach_get_center(from), to), from);
+    const Vec3 heading = reach_get_center(to) - launch;
+    if (len(heading) < REACH_EPSILON) {
+        return -1.0f;
+    }
+    const Vec3 direction = norm(heading);
+    const f32  jump =
+        reach_get_attempt(memory, from, to, launch, direction, true);
+    const f32 walk =
+        reach_get_attempt(memory, from, to, launch, direction, false);
+    if (jump < 0.0f) {
+        return walk;
+    }
+    return (walk < 0.0f) || (jump < walk) ? jump : walk;
+}
+
+static void* reach_run(void* data) {
+    ReachWorker* worker = static_cast<ReachWorker*>(data);
+    ReachBuild*  build = worker->build;
+    const Cube*  platforms = worker->grid.cubes;
+    for (;;) {
+        const u32 first =
+            __atomic_fetch_add(&build->next, REACH_BATCH, __ATOMIC_RELAXED);
+        if (build->len_platforms <= first) {
+            return null;
+        }
+        const u32 last = MIN(first + REACH_BATCH, build->len_platforms);
+        for (u32 i = first; i < last; ++i) {
+            for (u32 j = build->offsets[i]; j < build->offsets[i + 1]; ++j) {
+                build->costs[j] =
+                    reach_get_cost(&worker->grid,
+                                   &platforms[i],
+                                   &platforms[build->candidates[j]]);
+            }
+        }
+    }
+}
+
+// NOTE: `grid` must cover exactly the platforms the graph is for. Candidates,
+// per-candidate costs, one grid scratch buffer per thread, and the graph
+// itself are all built in `arena`. The graph is the same whatever the
+// thread count: each pair is simulated by exactly one thread, from the same
+// starting state.
+static Reach reach_get(const GridMemory* grid, Arena* arena) {
+    const u32  len_platforms = grid->len_cubes;
+    GridMemory memory = *grid;
+    hash_set_intersects_buffer(&memory, arena);
+    u32* offsets = arena_alloc<u32>(arena, len_platforms + 1);
+    offsets[0] = 0;
+    for (u32 i = 0; i < len_platforms; ++i) {
+        const Cube bounds = reach_get_bounds(&grid->cubes[i]);
+        hash_set_intersects(&memory, &bounds);
+        u32 len = 0;
+        for (u32 j = 0; j < memory.len_intersects; ++j) {
+            if ((memory.intersects[j] != &grid->cubes[i]) &&
+                reach_is_candidate(&grid->cubes[i], memory.intersects[j]))
+            {
+                ++len;
+            }
+        }
+        offsets[i + 1] = offsets[i] + len;
+    }
+    u32* candidates = arena_alloc<u32>(arena, offsets[len_platforms]);
+    for (u32 i = 0; i < len_platforms; ++i) {
+        const Cube bounds = reach_get_bounds(&grid->cubes[i]);
+        hash_set_intersects(&memory, &bounds);
+        u32 len = offsets[i];
+        for (u32 j = 0; j < memory.len_intersects; ++j) {
+            if ((memory.intersects[j] != &grid->cubes[i]) &&
+                reach_is_candidate(&grid->cubes[i], memory.intersects[j]))
+            {
+                candidates[len++] =
+                    static_cast<u32>(memory.intersects[j] - grid->cubes);
+            }
+        }
+        // NOTE: Queries report cubes in cell order; edges go out sorted.
+        for (u32 j = offsets[i] + 1; j < len; ++j) {
+            const u32 candidate = candidates[j];
+            u32       k = j;
+            for (; (offsets[i] < k) && (candidate < candidates[k - 1]); --k) {
+                candidates[k] = candidates[k - 1];
+            }
+            candidates[k] = candidate;
+        }
+    }
+    ReachBuild build = {
+        offsets,
+        candidates,
+        arena_alloc<f32>(arena, offsets[len_platforms]),
+        len_platforms,
+        0,
+    };
+    {
+        const i64 cores = sysconf(_SC_NPROCESSORS_ONLN);
+        u32       len_workers =
+            cores < 1 ? 1 : static_cast<u32>(MIN(cores, REACH_CAP_THREADS));
+        len_workers = MIN(len_workers,
+                          (len_platforms + (REACH_BATCH - 1)) / REACH_BATCH);
+        ReachWorker* workers = arena_alloc<ReachWorker>(arena, len_workers);
+        for (u32 i = 0; i < len_workers; ++i) {
+            workers[i].grid = *grid;
+            hash_set_intersects_buffer(&workers[i].grid, arena);
+            workers[i].build = &build;
+            EXIT_IF(pthread_create(&workers[i].thread,
+                                   null,
+                                   reach_run,
+                                   &workers[i]));
+        }
+        for (u32 i = 0; i < len_workers; ++i) {
+            EXIT_IF(pthread_join(workers[i].thread, null));
+        }
+    }
+    u32 len_edges = 0;
+    for (u32 i = 0; i < offsets[len_platforms]; ++i) {
+        if (0.0f <= build.costs[i]) {
+            ++len_edges;
+        }
+    }
+    u32*       edge_offsets = arena_alloc<u32>(arena, len_platforms + 1);
+    ReachEdge* edges = arena_alloc<ReachEdge>(arena, len_edges);
+    edge_offsets[0] = 0;
+    for (u32 i = 0; i < len_platforms; ++i) {
+        u32 len = edge_offsets[i];
+        for (u32 j = offsets[i]; j < offsets[i + 1]; ++j) {
+            if (0.0f <= build.costs[j]) {
+                edges[len++] = {candidates[j], build.costs[j]};
+            }
+        }
+        edge_offsets[i + 1] = len;
+    }
+    return {edge_offsets, edges, len_platforms, len_edges};
+}
+
+static f32 reach_get_estimate(const Cube* from, const Cube* to) {
+    return len(reach_get_center(to) - reach_get_center(from)) / SPEED_MAX;
+}
+
+static void reach_push(ReachNode* heap, u32* len_heap, ReachNode node) {
+    u32 i = (*len_heap)++;
+    for (; 0 < i; i = (i - 1) / 2) {
+        const u32 parent = (i - 1) / 2;
+        if (heap[parent].estimate <= node.estimate) {
+            break;
+        }
+        heap[i] = heap[parent];
+    }
+    heap[i] = node;
+}
+
+static ReachNode reach_pop(ReachNode* heap, u32* len_heap) {
+    const ReachNode top = heap[0];
+    const ReachNode last = heap[--(*len_heap)];
+    u32             i = 0;
+    for (;;) {
+        u32 child = (i * 2) + 1;
+        if (*len_heap <= child) {
+            break;
+        }
+        if (((child + 1) < *len_heap) &&
+            (heap[child + 1].estimate < heap[child].estimate))
+        {
+            ++child;
+        }
+        if (last.estimate <= heap[child].estimate) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+// NOTE: `A*` for each of `queries`, writing the cheapest route (both ends
+// included) into the matching entry of `paths`. The scratch state is
+// allocated once for the whole batch and reset per query by stamping rather
+// than clearing, so a batch costs what its searches touch, not a pass over
+// every platform per query. Scratch and paths both come from `arena`.
+static void reach_find_paths(const Reach*      reach,
+                             const Cube*       platforms,
+                             const ReachQuery* queries,
+                             ReachPath*        paths,
+                             u32               len_queries,
+                             Arena*            arena) {
+    const u32  len_platforms = reach->len_platforms;
+    f32*       costs = arena_alloc<f32>(arena, len_platforms);
+    u32*       parents = arena_alloc<u32>(arena, len_platforms);
+    u32*       stamps = arena_alloc<u32>(arena, len_platforms);
+    u32*       closed = arena_alloc<u32>(arena, len_platforms);
+    ReachNode* heap = arena_alloc<ReachNode>(arena, reach->len_edges + 1);
+    memset(stamps, 0, sizeof(u32) * len_platforms);
+    memset(closed, 0, sizeof(u32) * len_platforms);
+    for (u32 i = 0; i < len_queries; ++i) {
+        const ReachQuery query = queries[i];
+        const u32        stamp = i + 1;
+        EXIT_IF((len_platforms <= query.from) || (len_platforms <= query.to));
+        paths[i] = {null, 0, 0.0f};
+        u32 len_heap = 0;
+        costs[query.from] = 0.0f;
+        parents[query.from] = query.from;
+        stamps[query.from] = stamp;
+        reach_push(heap,
+                   &len_heap,
+                   {reach_get_estimate(&platforms[query.from],
+                                       &platforms[query.to]),
+                    query.from});
+        while (len_heap != 0) {
+            const u32 platform = reach_pop(heap, &len_heap).platform;
+            if (closed[platform] == stamp) {
+                continue;
+            }
+            closed[platform] = stamp;
+            if (platform == query.to) {
+                break;
+            }
+            for (u32 j = reach->offsets[platform];
+                 j < reach->offsets[platform + 1];
+                 ++j)
+            {
+                const ReachEdge edge = reach->edges[j];
+                const f32       cost = costs[platform] + edge.cost;
+                if ((closed[edge.platform] == stamp) ||
+                    ((stamps[edge.platform] == stamp) &&
+                     (costs[edge.platform] <= cost)))
+                {
+                    continue;
+                }
+                costs[edge.platform] = cost;
+                parents[edge.platform] = platform;
+                stamps[edge.platform] = stamp;
+                const f32 estimate =
+                    reach_get_estimate(&platforms[edge.platform],
+                                       &platforms[query.to]);
+                reach_push(heap,
+                           &len_heap,
+                           {cost + estimate, edge.platform});
+            }
+        }
+        if (closed[query.to] != stamp) {
+            continue;
+        }
+        u32 len_path = 1;
+        for (u32 j = query.to; j != query.from; j = parents[j]) {
+            ++len_path;
+        }
+        u32* path = arena_alloc<u32>(arena, len_path);
+        u32  j = query.to;
+        for (u32 k = len_path; 0 < k; --k) {
+            path[k - 1] = j;
+            j = parents[j];
+        }
+        paths[i] = {path, len_path, costs[query.to]};
+    }
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __RESOLUTION_H__
+#define __RESOLUTION_H__
+
+#include "scene.hpp"
+
+// NOTE: Driven by `TIMER.gpu_time`, the smoothed sum of every pass in
+// `scene_draw`.
+#define RESOLUTION_SCALE_STEP 0.25f
+#define RESOLUTION_COOLDOWN   30
+
+// NOTE: Fractions of the frame budget; between the two the scale holds
+// steady, which keeps it from oscillating.
+#define RESOLUTION_BUDGET_HIGH 0.85f
+#define RESOLUTION_BUDGET_LOW  0.5f
+
+struct Resolution {
+    f32 scale;
+    f32 scale_min;
+    f32 scale_max;
+    f32 budget;
+    i32 window_width;
+    i32 window_height;
+    u32 cooldown;
+};
+
+static Resolution RESOLUTION;
+
+static void resolution_set_scale(f32 scale_min,
+                                 f32 scale_max,
+                                 f32 budget,
+                                 i32 window_width,
+                                 i32 window_height) {
+    RESOLUTION.scale = scale_min;
+    RESOLUTION.scale_min = scale_min;
+    RESOLUTION.scale_max = scale_max;
+    RESOLUTION.budget = budget;
+    RESOLUTION.window_width = window_width;
+    RESOLUTION.window_height = window_height;
+    RESOLUTION.cooldown = RESOLUTION_COOLDOWN;
+}
+
+static i32 resolution_get_size(i32 window_size) {
+    return MAX(static_cast<i32>(static_cast<f32>(window_size) /
+                                RESOLUTION.scale),
+               1);
+}
+
+// NOTE: Called between frames, so reallocating the off-screen targets never
+// races a draw that still references them.
+static void resolution_set(i32 window_width, i32 window_height) {
+    bool changed = (window_width != RESOLUTION.window_width) ||
+                   (window_height != RESOLUTION.window_height);
+    RESOLUTION.window_width = window_width;
+    RESOLUTION.window_height = window_height;
+    if (RESOLUTION.cooldown != 0) {
+        --RESOLUTION.cooldown;
+    } else if (((RESOLUTION.budget * RESOLUTION_BUDGET_HIGH) <
+                TIMER.gpu_time) &&
+               (RESOLUTION.scale < RESOLUTION.scale_max))
+    {
+        RESOLUTION.scale = MIN(RESOLUTION.scale + RESOLUTION_SCALE_STEP,
+                               RESOLUTION.scale_max);
+        changed = true;
+    } else if ((TIMER.gpu_time <
+                (RESOLUTION.budget * RESOLUTION_BUDGET_LOW)) &&
+               (RESOLUTION.scale_min < RESOLUTION.scale))
+    {
+        RESOLUTION.scale = MAX(RESOLUTION.scale - RESOLUTION_SCALE_STEP,
+                               RESOLUTION.scale_min);
+        changed = true;
+    }
+    if (!changed) {
+        return;
+    }
+    const i32 width = resolution_get_size(window_width);
+    const i32 height = resolution_get_size(window_height);
+    if ((width != OBJECT.width) || (height != OBJECT.height)) {
+        scene_set_frame_buffer(width, height);
+    }
+    // NOTE: Queries still in flight measured the old resolution; let them
+    // drain before judging the new one.
+    RESOLUTION.cooldown = RESOLUTION_COOLDOWN;
+}
+
+#endif
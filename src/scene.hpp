@@ -1,17 +1,42 @@
 #ifndef __SCENE_H__
 #define __SCENE_H__
 
+#include "bind.hpp"
 #include "init.hpp"
-#include "scene_assets_codegen.hpp"
+#include "occlusion.hpp"
+#include "scene_assets.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
+
+#include <string.h>
+
+// NOTE: Everything the scene and cull programs read per frame, laid out for
+// the `std140` block `FRAME`; `pad` fills out `position`'s `vec3` slot.
+struct SceneFrame {
+    Mat4 projection;
+    Mat4 view;
+    Vec3 position;
+    f32  pad;
+};
+
+static_assert(sizeof(SceneFrame) == (sizeof(f32) * ((16 * 2) + 4)),
+              "sizeof(SceneFrame)");
 
 struct Object {
-    u32 vertex_array;
-    u32 vertex_buffer;
-    u32 element_buffer;
-    u32 instance_buffer;
-    u32 frame_buffer;
-    u32 render_buffer_color;
-    u32 render_buffer_depth;
+    SceneFrame frame;
+    u32        program;
+    i32        uniform_phase;
+    u32        vertex_array;
+    u32        vertex_buffer;
+    u32        element_buffer;
+    u32        instance_buffer;
+    u32        uniform_buffer;
+    u32        frame_buffer;
+    u32        render_buffer_color;
+    u32        texture_depth;
+    i32        width;
+    i32        height;
+    u32        len_instances;
 };
 
 static Object OBJECT;
@@ -20,31 +45,10 @@ static Object OBJECT;
 #define INDEX_NORMAL   1
 #define INDEX_INSTANCE 2
 
-#define VERTEX_OFFSET 0
+#define INDEX_VISIBLE_PREV (INDEX_INSTANCE + 5)
+#define INDEX_VISIBLE      (INDEX_INSTANCE + 6)
 
-#define CHECK_GL_ERROR()                                   \
-    {                                                      \
-        switch (glGetError()) {                            \
-        case GL_INVALID_ENUM: {                            \
-            EXIT_WITH("GL_INVALID_ENUM");                  \
-        }                                                  \
-        case GL_INVALID_VALUE: {                           \
-            EXIT_WITH("GL_INVALID_VALUE");                 \
-        }                                                  \
-        case GL_INVALID_OPERATION: {                       \
-            EXIT_WITH("GL_INVALID_OPERATION");             \
-        }                                                  \
-        case GL_INVALID_FRAMEBUFFER_OPERATION: {           \
-            EXIT_WITH("GL_INVALID_FRAMEBUFFER_OPERATION"); \
-        }                                                  \
-        case GL_OUT_OF_MEMORY: {                           \
-            EXIT_WITH("GL_OUT_OF_MEMORY");                 \
-        }                                                  \
-        case GL_NO_ERROR: {                                \
-            break;                                         \
-        }                                                  \
-        }                                                  \
-    }
+#define VERTEX_OFFSET 0
 
 static void scene_set_vertex_attrib(u32         index,
                                     i32         size,
@@ -54,10 +58,37 @@ static void scene_set_vertex_attrib(u32         index,
     glVertexAttribPointer(index, size, GL_FLOAT, false, stride, offset);
 }
 
-template <usize W, usize H>
-static void scene_set_buffers() {
+// NOTE: Safe to call between frames; names stay put and only their storage
+// is replaced, so the frame buffer's attachments remain valid.
+static void scene_set_frame_buffer(i32 width, i32 height) {
+    OBJECT.width = width;
+    OBJECT.height = height;
+    glBindRenderbuffer(GL_RENDERBUFFER, OBJECT.render_buffer_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB, width, height);
+    bind_texture(OBJECT.texture_depth);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_DEPTH_COMPONENT,
+                 width,
+                 height,
+                 0,
+                 GL_DEPTH_COMPONENT,
+                 GL_FLOAT,
+                 null);
+    occlusion_set_texture(width, height);
+    CHECK_GL_ERROR();
+}
+
+// NOTE: `bounds[i]` is the `Cube` covering `instances[i]`.
+static void scene_set_buffers(i32             width,
+                              i32             height,
+                              const Instance* instances,
+                              const Cube*     bounds,
+                              u32             len_instances) {
+    OBJECT.len_instances = len_instances;
+    occlusion_set_buffers(bounds, len_instances);
     glGenVertexArrays(1, &OBJECT.vertex_array);
-    glBindVertexArray(OBJECT.vertex_array);
+    bind_vertex_array(OBJECT.vertex_array);
     CHECK_GL_ERROR();
     {
         glGenBuffers(1, &OBJECT.vertex_buffer);
@@ -97,10 +128,10 @@ static void scene_set_buffers() {
         glGenBuffers(1, &OBJECT.instance_buffer);
         glBindBuffer(GL_ARRAY_BUFFER, OBJECT.instance_buffer);
         glBufferData(GL_ARRAY_BUFFER,
-                     sizeof(INSTANCES),
-                     &INSTANCES[0].matrix.cell[0][0],
+                     static_cast<i64>(sizeof(Instance) * len_instances),
+                     instances,
                      GL_STATIC_DRAW);
-        const i32 stride = sizeof(INSTANCES[0]);
+        const i32 stride = sizeof(Instance);
         // NOTE: Instances are limited to `sizeof(f32) * 4`, so `Instance` must
         // be constructed in multiple layers.
         const usize offset = sizeof(f32) * 4;
@@ -124,73 +155,170 @@ static void scene_set_buffers() {
         CHECK_GL_ERROR();
     }
     {
-        glGenRenderbuffers(1, &OBJECT.render_buffer_color);
-        glBindRenderbuffer(GL_RENDERBUFFER, OBJECT.render_buffer_color);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB, W, H);
+        glBindBuffer(GL_ARRAY_BUFFER, OCCLUSION.visible_prev_buffer);
+        scene_set_vertex_attrib(INDEX_VISIBLE_PREV, 1, sizeof(f32), null);
+        glVertexAttribDivisor(INDEX_VISIBLE_PREV, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, OCCLUSION.visible_buffer);
+        scene_set_vertex_attrib(INDEX_VISIBLE, 1, sizeof(f32), null);
+        glVertexAttribDivisor(INDEX_VISIBLE, 1);
         CHECK_GL_ERROR();
     }
     {
-        glGenRenderbuffers(1, &OBJECT.render_buffer_depth);
-        glBindRenderbuffer(GL_RENDERBUFFER, OBJECT.render_buffer_depth);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, W, H);
+        // NOTE: Starts out matching the zeroed `OBJECT.frame`, so the first
+        // `scene_set_frame` always uploads.
+        glGenBuffers(1, &OBJECT.uniform_buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, OBJECT.uniform_buffer);
+        glBufferData(GL_UNIFORM_BUFFER,
+                     sizeof(SceneFrame),
+                     &OBJECT.frame,
+                     GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER,
+                         INIT_BINDING_FRAME,
+                         OBJECT.uniform_buffer);
         CHECK_GL_ERROR();
     }
+    {
+        glGenRenderbuffers(1, &OBJECT.render_buffer_color);
+        // NOTE: Depth lives in a texture rather than a render buffer so it
+        // can be reduced into the `Hi-Z` pyramid.
+        glGenTextures(1, &OBJECT.texture_depth);
+        bind_texture(OBJECT.texture_depth);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        scene_set_frame_buffer(width, height);
+    }
     {
         glGenFramebuffers(1, &OBJECT.frame_buffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, OBJECT.frame_buffer);
+        bind_frame_buffer(OBJECT.frame_buffer);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER,
                                   GL_COLOR_ATTACHMENT0,
                                   GL_RENDERBUFFER,
                                   OBJECT.render_buffer_color);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER,
-                                  GL_DEPTH_ATTACHMENT,
-                                  GL_RENDERBUFFER,
-                                  OBJECT.render_buffer_depth);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_DEPTH_ATTACHMENT,
+                               GL_TEXTURE_2D,
+                               OBJECT.texture_depth,
+                               0);
+        // NOTE: Both belong to the frame buffer rather than the context, so
+        // they only need saying once.
+        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
         CHECK_GL_ERROR();
     }
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         CHECK_GL_ERROR();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bind_frame_buffer(0);
     glEnable(GL_DEPTH_TEST);
     CHECK_GL_ERROR();
 }
 
-template <usize W, usize H>
-static void scene_draw(GLFWwindow* window, i32 width, i32 height) {
+// NOTE: `program` is one of the `SHADER_VARIANTS`; it reads `FRAME` like the
+// cull program does.
+static void scene_set_program(u32 program) {
+    OBJECT.program = program;
+    OBJECT.uniform_phase = glGetUniformLocation(program, "PHASE");
+    init_set_uniform_block(program, "FRAME", INIT_BINDING_FRAME);
+}
+
+// NOTE: Uploads only what changed since the last call; a still camera costs
+// nothing.
+static void scene_set_frame(const Mat4* projection,
+                            const Mat4* view,
+                            Vec3        position) {
+    SceneFrame frame = {};
+    frame.projection = *projection;
+    frame.view = *view;
+    frame.position = position;
+    if (!memcmp(&frame, &OBJECT.frame, sizeof(SceneFrame))) {
+        return;
+    }
+    OBJECT.frame = frame;
+    glBindBuffer(GL_UNIFORM_BUFFER, OBJECT.uniform_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SceneFrame), &frame);
+}
+
+static void scene_draw_instances() {
+    bind_vertex_array(OBJECT.vertex_array);
+    glDrawElementsInstanced(GL_TRIANGLES,
+                            sizeof(INDICES) / sizeof(INDICES[0]),
+                            GL_UNSIGNED_INT,
+                            reinterpret_cast<void*>(VERTEX_OFFSET),
+                            static_cast<i32>(OBJECT.len_instances));
+}
+
+// NOTE: Replaces instances `first` through `first + len - 1` in place.
+static void scene_set_instances(u32             first,
+                                const Instance* instances,
+                                const Cube*     bounds,
+                                u32             len) {
+    glBindBuffer(GL_ARRAY_BUFFER, OBJECT.instance_buffer);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    static_cast<i64>(sizeof(Instance) * first),
+                    static_cast<i64>(sizeof(Instance) * len),
+                    instances);
+    occlusion_set_bounds(first, bounds, len);
+    CHECK_GL_ERROR();
+}
+
+static void scene_draw(i32 width, i32 height) {
+    TRACE_SCOPE("scene_draw");
     {
         // NOTE: Bind off-screen render target.
-        glBindFramebuffer(GL_FRAMEBUFFER, OBJECT.frame_buffer);
-        glDrawBuffer(GL_COLOR_ATTACHMENT0);
-        glViewport(0, 0, W, H);
+        bind_frame_buffer(OBJECT.frame_buffer);
+        bind_viewport(OBJECT.width, OBJECT.height);
+        timer_begin(TIMER_CLEAR);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        timer_end();
+    }
+    {
+        // NOTE: Draw scene, starting with whatever was visible last frame.
+        timer_begin(TIMER_DRAW);
+        bind_program(OBJECT.program);
+        glUniform1i(OBJECT.uniform_phase, 0);
+        scene_draw_instances();
+        timer_end();
+    }
+    {
+        // NOTE: Test every instance against the depth drawn so far.
+        timer_begin(TIMER_HIZ);
+        occlusion_set_hiz(OBJECT.texture_depth);
+        timer_end();
+        timer_begin(TIMER_CULL);
+        occlusion_set_visible();
+        timer_end();
     }
     {
-        // NOTE: Draw scene.
-        glBindVertexArray(OBJECT.vertex_array);
-        glDrawElementsInstanced(GL_TRIANGLES,
-                                sizeof(INDICES) / sizeof(INDICES[0]),
-                                GL_UNSIGNED_INT,
-                                reinterpret_cast<void*>(VERTEX_OFFSET),
-                                COUNT_PLATFORMS);
+        // NOTE: Draw anything that has just come into view.
+        timer_begin(TIMER_DRAW_NEW);
+        bind_frame_buffer(OBJECT.frame_buffer);
+        bind_viewport(OBJECT.width, OBJECT.height);
+        bind_program(OBJECT.program);
+        glUniform1i(OBJECT.uniform_phase, 1);
+        scene_draw_instances();
+        occlusion_swap_visible();
+        timer_end();
     }
     {
-        // NOTE: Blit off-screen to on-screen.
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, OBJECT.frame_buffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-        glViewport(0, 0, width, height);
+        // NOTE: Blit off-screen to on-screen. Blits ignore the viewport, so
+        // it's left at the off-screen size for the next frame.
+        timer_begin(TIMER_BLIT);
+        bind_read_frame_buffer(OBJECT.frame_buffer);
+        bind_draw_frame_buffer(0);
         glBlitFramebuffer(0,
                           0,
-                          W,
-                          H,
+                          OBJECT.width,
+                          OBJECT.height,
                           0,
                           0,
                           width,
                           height,
                           GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT,
                           GL_NEAREST);
+        timer_end();
     }
-    glfwSwapBuffers(window);
+    timer_end_frame();
 }
 
 static void scene_delete_buffers() {
@@ -198,9 +326,11 @@ static void scene_delete_buffers() {
     glDeleteBuffers(1, &OBJECT.vertex_buffer);
     glDeleteBuffers(1, &OBJECT.element_buffer);
     glDeleteBuffers(1, &OBJECT.instance_buffer);
+    glDeleteBuffers(1, &OBJECT.uniform_buffer);
     glDeleteFramebuffers(1, &OBJECT.frame_buffer);
     glDeleteRenderbuffers(1, &OBJECT.render_buffer_color);
-    glDeleteRenderbuffers(1, &OBJECT.render_buffer_depth);
+    glDeleteTextures(1, &OBJECT.texture_depth);
+    occlusion_delete_buffers();
 }
 
 #endif
@@ -50,33 +50,6 @@ static const u32 INDICES[] = {
     20, 21, 22,
     22, 23, 20,
 };
-static const Vec3 PLATFORM_POSITIONS[] = {
-    {   0.0f,     4.0f,     0.0f },
-    {   0.0f,     6.0f,   -10.0f },
-    {   0.0f,     8.0f,   -20.0f },
-    {  10.0f,    10.0f,   -20.0f },
-    {  10.0f,    12.0f,   -10.0f },
-    {  10.0f,    14.0f,     0.0f },
-    {  10.0f,     4.0f,     0.0f },
-    {  10.0f,     4.0f,   -10.0f },
-    {  10.0f,     4.0f,   -20.0f },
-    { -20.0f,     6.0f,     0.0f },
-    { -10.0f,     0.0f,   -10.0f },
-    { -20.0f,     2.5f,   -10.0f },
-    {  -6.25f,    4.125f, -25.0f },
-    {  -2.5f,    17.25f,   -7.5f },
-    {  -7.5f,    20.0f,     7.5f },
-    {  -7.5f,    20.0f,    17.5f },
-    { -17.5f,    20.0f,    17.5f },
-    {   0.0f,     8.0f,   -40.0f },
-    {  10.0f,     7.0f,   -35.0f },
-    { -20.0f,     9.0f,   -20.0f },
-    { -40.0f,     2.5f,   -55.0f },
-    { -45.0f,     5.0f,   -40.0f },
-    { -25.0f,    30.0f,    -5.0f },
-    { -35.0f,    26.5f,     0.0f },
-    { -40.0f,    22.5f,     5.0f },
-};
 // clang-format on
 
 #endif
@@ -0,0 +1,678 @@
+#include "arena.hpp"
+#include "histogram.hpp"
+#include "level.hpp"
+#include "net.hpp"
+#include "pacing.hpp"
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+// NOTE: Authoritative server: no window and no GL, just `set_motion` for
+// every connected player at the game's own tick rate, fed by input packets
+// and answered with snapshots (see `net.hpp`). A player is whoever sends a
+// well-formed input from an address not seen before, up to
+// `NET_CAP_PLAYERS`.
+//
+// Each client is sent a snapshot every `SERVER_SNAPSHOT_TICKS` ticks, on the
+// ticks matching its index, so every tick sends to an even share of clients
+// rather than every client landing on the same one. The delta is against
+// the newest snapshot the client acknowledged, as long as it is still in
+// `SERVER_HISTORY`; clients on the same tick mostly share a baseline, so
+// each distinct baseline is encoded once per tick and sent to all of them.
+//
+// `--clients <n>` also runs `n` scripted clients over loopback on a second
+// thread, each on its own socket, which check the state they decoded against
+// the server's at the end.
+#define SERVER_RATE           480lu
+#define SERVER_TICK           (NANOSECONDS / SERVER_RATE)
+#define SERVER_SNAPSHOT_TICKS 24
+#define SERVER_HISTORY        128
+#define SERVER_SECONDS        5
+#define SERVER_WARMUP         SERVER_RATE
+
+// NOTE: Baselines always fall on a client's own ticks, so a tick never has
+// more than this many to encode.
+#define SERVER_CAP_ENCODED ((SERVER_HISTORY / SERVER_SNAPSHOT_TICKS) + 2)
+
+#define SERVER_CAP_SLOTS (NET_CAP_PLAYERS * 2)
+
+#define SERVER_BUFFER_SIZE (1 << 22)
+
+#define SERVER_CAP_MESSAGES (1 << 8)
+
+// NOTE: Scripted clients send input at the game's frame rate, keep the
+// snapshot they last acknowledged, the one a delta in flight may be against,
+// and the one being received.
+#define CLIENT_PERIOD     (NANOSECONDS / 60lu)
+#define CLIENT_TICKS      (SERVER_RATE / 60lu)
+#define CLIENT_STATES     3
+#define CLIENT_CAP_EVENTS 64
+#define CLIENT_DRAIN      (NANOSECONDS / 4lu)
+
+struct ServerClient {
+    sockaddr_in address;
+    Player      player;
+    Input       input;
+    u32         sequence;
+    u32         ack;
+};
+
+struct ServerEncoded {
+    u8* packets;
+    u32 sizes[NET_CAP_FRAGMENTS];
+    u32 baseline;
+    u8  count;
+};
+
+struct Server {
+    ServerClient  clients[NET_CAP_PLAYERS];
+    NetPlayer     history[SERVER_HISTORY][NET_CAP_PLAYERS];
+    u32           len_history[SERVER_HISTORY];
+    u32           slots[SERVER_CAP_SLOTS];
+    ServerEncoded encoded[SERVER_CAP_ENCODED];
+    mmsghdr       messages[SERVER_CAP_MESSAGES];
+    iovec         vectors[SERVER_CAP_MESSAGES];
+    u8            packet[NET_CAP_PACKET];
+    GridMemory    grid;
+    Histogram     simulate;
+    Histogram     snapshot;
+    u64           bytes_sent;
+    u64           packets_sent;
+    u64           snapshots_sent;
+    u64           dropped;
+    u64           refused;
+    u64           late;
+    u32           len_clients;
+    u32           len_encoded;
+    u32           len_messages;
+    u32           tick;
+    i32           socket;
+};
+
+static Server SERVER;
+
+struct ClientState {
+    NetPlayer players[NET_CAP_PLAYERS];
+    u64       received;
+    u32       tick;
+    u32       baseline;
+    u32       len_players;
+    u8        count;
+    bool      complete;
+};
+
+struct Client {
+    ClientState* states;
+    u32          sequence;
+    u32          ack;
+    i32          socket;
+};
+
+struct Clients {
+    Client*   clients;
+    u8        packet[NET_CAP_PACKET];
+    pthread_t thread;
+    u64       snapshots;
+    u64       undecodable;
+    u64       refused;
+    u64       mismatched;
+    u64       unverified;
+    u32       len_clients;
+    i32       epoll;
+    bool      running;
+};
+
+static Clients CLIENTS;
+
+static sockaddr_in server_get_address(u32 host, u16 port) {
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(host);
+    address.sin_port = htons(port);
+    return address;
+}
+
+static i32 server_get_socket() {
+    const i32 fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    EXIT_IF(fd < 0);
+    return fd;
+}
+
+static void server_open(u16 port) {
+    SERVER.socket = server_get_socket();
+    const i32 size = SERVER_BUFFER_SIZE;
+    EXIT_IF(setsockopt(SERVER.socket,
+                       SOL_SOCKET,
+                       SO_RCVBUF,
+                       &size,
+                       sizeof(size)));
+    EXIT_IF(setsockopt(SERVER.socket,
+                       SOL_SOCKET,
+                       SO_SNDBUF,
+                       &size,
+                       sizeof(size)));
+    const sockaddr_in address = server_get_address(INADDR_ANY, port);
+    if (bind(SERVER.socket,
+             reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)))
+    {
+        EXIT_WITH(strerror(errno));
+    }
+}
+
+static u32 server_get_slot(const sockaddr_in* address) {
+    const u64 key = (static_cast<u64>(address->sin_addr.s_addr) << 16) |
+                    static_cast<u64>(address->sin_port);
+    return static_cast<u32>((key * 0x9E3779B97F4A7C15lu) >> 32) &
+           (SERVER_CAP_SLOTS - 1);
+}
+
+// NOTE: Returns `null` once every slot is taken.
+static ServerClient* server_get_client(const sockaddr_in* address) {
+    u32 slot = server_get_slot(address);
+    for (; SERVER.slots[slot] != 0; slot = (slot + 1) & (SERVER_CAP_SLOTS - 1))
+    {
+        ServerClient* client = &SERVER.clients[SERVER.slots[slot] - 1];
+        if ((client->address.sin_addr.s_addr == address->sin_addr.s_addr) &&
+            (client->address.sin_port == address->sin_port))
+        {
+            return client;
+        }
+    }
+    if (SERVER.len_clients == NET_CAP_PLAYERS) {
+        return null;
+    }
+    const u32     index = SERVER.len_clients++;
+    ServerClient* client = &SERVER.clients[index];
+    SERVER.slots[slot] = index + 1;
+    *client = {};
+    client->address = *address;
+    set_player(&client->player);
+    // NOTE: Older snapshots must see a player that hadn't joined yet as all
+    // zeroes, same as the clients do.
+    for (u32 i = 0; i < SERVER_HISTORY; ++i) {
+        SERVER.history[i][index] = {};
+    }
+    return client;
+}
+
+static void server_receive() {
+    for (;;) {
+        sockaddr_in address;
+        socklen_t   size_address = sizeof(address);
+        const isize size = recvfrom(SERVER.socket,
+                                    SERVER.packet,
+                                    sizeof(SERVER.packet),
+                                    0,
+                                    reinterpret_cast<sockaddr*>(&address),
+                                    &size_address);
+        if (size < 0) {
+            EXIT_IF((errno != EAGAIN) && (errno != EWOULDBLOCK));
+            return;
+        }
+        NetInput input;
+        if (!net_get_input(SERVER.packet, static_cast<u32>(size), &input) ||
+            (SERVER.tick < input.ack))
+        {
+            ++SERVER.refused;
+            continue;
+        }
+        ServerClient* client = server_get_client(&address);
+        if (!client) {
+            ++SERVER.refused;
+            continue;
+        }
+        if (input.sequence <= client->sequence) {
+            continue;
+        }
+        client->sequence = input.sequence;
+        client->ack = MAX(client->ack, input.ack);
+        client->input = {input.view_target, 0, input.keys};
+    }
+}
+
+static void server_simulate() {
+    NetPlayer* history = SERVER.history[SERVER.tick % SERVER_HISTORY];
+    for (u32 i = 0; i < SERVER.len_clients; ++i) {
+        ServerClient* client = &SERVER.clients[i];
+        // NOTE: Nothing to steer with until the first input arrives.
+        if (client->sequence != 0) {
+            set_speed(&client->input, &client->player);
+        }
+        set_motion(&SERVER.grid, &client->player);
+        history[i] = net_get_player(&client->player);
+    }
+    SERVER.len_history[SERVER.tick % SERVER_HISTORY] = SERVER.len_clients;
+}
+
+static const ServerEncoded* server_get_encoded(u32 baseline) {
+    for (u32 i = 0; i < SERVER.len_encoded; ++i) {
+        if (SERVER.encoded[i].baseline == baseline) {
+            return &SERVER.encoded[i];
+        }
+    }
+    EXIT_IF(SERVER.len_encoded == SERVER_CAP_ENCODED);
+    ServerEncoded* encoded = &SERVER.encoded[SERVER.len_encoded++];
+    encoded->packets =
+        arena_alloc<u8>(&ARENAS.frame, NET_CAP_FRAGMENTS * NET_CAP_PACKET);
+    encoded->baseline = baseline;
+    encoded->count = net_put_snapshot(
+        encoded->packets,
+        encoded->sizes,
+        SERVER.history[SERVER.tick % SERVER_HISTORY],
+        baseline == 0 ? null : SERVER.history[baseline % SERVER_HISTORY],
+        SERVER.len_clients,
+        SERVER.tick,
+        baseline);
+    return encoded;
+}
+
+// NOTE: One `sendmmsg` per `SERVER_CAP_MESSAGES` fragments rather than one
+// `sendto` each. A datagram the send buffer has no room for is dropped and
+// counted, same as the network would.
+static void server_flush() {
+    for (u32 i = 0; i < SERVER.len_messages;) {
+        const i32 len = sendmmsg(SERVER.socket,
+                                 &SERVER.messages[i],
+                                 SERVER.len_messages - i,
+                                 0);
+        if (len < 0) {
+            EXIT_IF((errno != EAGAIN) && (errno != EWOULDBLOCK));
+            ++SERVER.dropped;
+            ++i;
+            continue;
+        }
+        for (u32 j = i; j < (i + static_cast<u32>(len)); ++j) {
+            SERVER.bytes_sent += SERVER.messages[j].msg_len;
+        }
+        SERVER.packets_sent += static_cast<u64>(len);
+        i += static_cast<u32>(len);
+    }
+    SERVER.len_messages = 0;
+}
+
+static void server_send() {
+    arena_reset(&ARENAS.frame);
+    SERVER.len_encoded = 0;
+    for (u32 i = SERVER.tick % SERVER_SNAPSHOT_TICKS; i < SERVER.len_clients;
+         i += SERVER_SNAPSHOT_TICKS)
+    {
+        const ServerClient* client = &SERVER.clients[i];
+        if (client->sequence == 0) {
+            continue;
+        }
+        // NOTE: Acknowledging a tick this client was never sent can only
+        // fall back to a full snapshot.
+        const u32            age = SERVER.tick - client->ack;
+        const ServerEncoded* encoded = server_get_encoded(
+            (client->ack != 0) && (age < SERVER_HISTORY) &&
+                    ((age % SERVER_SNAPSHOT_TICKS) == 0)
+                ? client->ack
+                : 0);
+        for (u8 j = 0; j < encoded->count; ++j) {
+            if (SERVER.len_messages == SERVER_CAP_MESSAGES) {
+                server_flush();
+            }
+            iovec*   vector = &SERVER.vectors[SERVER.len_messages];
+            mmsghdr* message = &SERVER.messages[SERVER.len_messages++];
+            vector->iov_base = &encoded->packets[j * NET_CAP_PACKET];
+            vector->iov_len = encoded->sizes[j];
+            *message = {};
+            message->msg_hdr.msg_name =
+                const_cast<sockaddr_in*>(&client->address);
+            message->msg_hdr.msg_namelen = sizeof(client->address);
+            message->msg_hdr.msg_iov = vector;
+            message->msg_hdr.msg_iovlen = 1;
+        }
+        ++SERVER.snapshots_sent;
+    }
+    server_flush();
+}
+
+static void server_reset_stats() {
+    histogram_reset(&SERVER.simulate);
+    histogram_reset(&SERVER.snapshot);
+    SERVER.bytes_sent = 0;
+    SERVER.packets_sent = 0;
+    SERVER.snapshots_sent = 0;
+    SERVER.dropped = 0;
+    SERVER.late = 0;
+}
+
+// NOTE: Stats cover the `ticks` after `SERVER_WARMUP`, by which point every
+// scripted client has joined and moved on to deltas.
+static void server_run(u64 ticks) {
+    const u64 start = pacing_now();
+    for (u64 i = 1; i <= (SERVER_WARMUP + ticks); ++i) {
+        if (i == (SERVER_WARMUP + 1)) {
+            server_reset_stats();
+        }
+        const u64 deadline = start + (i * SERVER_TICK);
+        pacing_sleep_until(deadline);
+        const u64 now = pacing_now();
+        if ((deadline + SERVER_TICK) < now) {
+            ++SERVER.late;
+        }
+        SERVER.tick = static_cast<u32>(i);
+        server_receive();
+        server_simulate();
+        const u64 simulated = pacing_now();
+        histogram_add(&SERVER.simulate, simulated - now);
+        server_send();
+        histogram_add(&SERVER.snapshot, pacing_now() - simulated);
+    }
+}
+
+static void client_receive(Client* client, u32 size) {
+    NetFragment fragment;
+    u32         next;
+    const u8*   cursor =
+        net_get_fragment(CLIENTS.packet, size, &fragment, &next);
+    if (!cursor) {
+        ++CLIENTS.refused;
+        return;
+    }
+    if (fragment.tick <= client->ack) {
+        return;
+    }
+    ClientState*       state = null;
+    const ClientState* baseline = null;
+    for (u32 i = 0; i < CLIENT_STATES; ++i) {
+        ClientState* candidate = &client->states[i];
+        if (candidate->tick == fragment.tick) {
+            state = candidate;
+        } else if (candidate->complete &&
+                   (candidate->tick == fragment.baseline))
+        {
+            baseline = candidate;
+        }
+    }
+    if (!state) {
+        if ((fragment.baseline != 0) && !baseline) {
+            ++CLIENTS.undecodable;
+            return;
+        }
+        // NOTE: Never the baseline, nor the newest acknowledged state, which
+        // the next delta may well be against.
+        for (u32 i = 0; i < CLIENT_STATES; ++i) {
+            ClientState* candidate = &client->states[i];
+            if ((candidate == baseline) ||
+                (candidate->complete && (candidate->tick == client->ack)))
+            {
+                continue;
+            }
+            if (!state || (candidate->tick < state->tick)) {
+                state = candidate;
+            }
+        }
+        const u32 len_baseline =
+            baseline ? MIN(baseline->len_players, fragment.len_players) : 0;
+        if (baseline) {
+            memcpy(state->players,
+                   baseline->players,
+                   sizeof(NetPlayer) * len_baseline);
+        }
+        memset(&state->players[len_baseline],
+               0,
+               sizeof(NetPlayer) * (fragment.len_players - len_baseline));
+        state->received = 0;
+        state->tick = fragment.tick;
+        state->baseline = fragment.baseline;
+        state->len_players = fragment.len_players;
+        state->count = fragment.count;
+        state->complete = false;
+    } else if (state->complete || (state->baseline != fragment.baseline) ||
+               (state->len_players != fragment.len_players) ||
+               (state->count != fragment.count))
+    {
+        ++CLIENTS.refused;
+        return;
+    }
+    if (state->received & (1lu << fragment.index)) {
+        return;
+    }
+    if (!net_get_players(cursor,
+                         CLIENTS.packet + size,
+                         next,
+                         state->len_players,
+                         state->players))
+    {
+        ++CLIENTS.refused;
+        state->tick = 0;
+        return;
+    }
+    state->received |= 1lu << fragment.index;
+    if (static_cast<u32>(__builtin_popcountll(state->received)) ==
+        state->count)
+    {
+        state->complete = true;
+        client->ack = state->tick;
+        ++CLIENTS.snapshots;
+    }
+}
+
+static void client_send(u32 index, u64 step) {
+    Client*     client = &CLIENTS.clients[index];
+    const Input scripted =
+        get_scripted_input((step * CLIENT_TICKS) + (index * 97));
+    const NetInput input = {
+        scripted.view_target,
+        ++client->sequence,
+        client->ack,
+        scripted.keys,
+    };
+    const u32 size = net_put_input(CLIENTS.packet, &input);
+    if (send(client->socket, CLIENTS.packet, size, 0) < 0) {
+        EXIT_IF((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                (errno != ECONNREFUSED));
+    }
+}
+
+static void* client_run(void*) {
+    u64 step = 0;
+    u64 next = pacing_now();
+    while (__atomic_load_n(&CLIENTS.running, __ATOMIC_ACQUIRE)) {
+        u64 now = pacing_now();
+        if (next <= now) {
+            for (u32 i = 0; i < CLIENTS.len_clients; ++i) {
+                client_send(i, step);
+            }
+            ++step;
+            next += CLIENT_PERIOD;
+            now = pacing_now();
+        }
+        epoll_event events[CLIENT_CAP_EVENTS];
+        // NOTE: Rounded up to whole milliseconds, so it never spins.
+        const i32 timeout =
+            next <= now
+                ? 0
+                : static_cast<i32>(((next - now) + 999999lu) / 1000000lu);
+        const i32 len_events =
+            epoll_wait(CLIENTS.epoll, events, CLIENT_CAP_EVENTS, timeout);
+        if (len_events < 0) {
+            EXIT_IF(errno != EINTR);
+            continue;
+        }
+        for (i32 i = 0; i < len_events; ++i) {
+            Client* client = &CLIENTS.clients[events[i].data.u32];
+            for (;;) {
+                const isize size = recv(client->socket,
+                                        CLIENTS.packet,
+                                        sizeof(CLIENTS.packet),
+                                        0);
+                if (size < 0) {
+                    EXIT_IF((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                            (errno != ECONNREFUSED));
+                    break;
+                }
+                client_receive(client, static_cast<u32>(size));
+            }
+        }
+    }
+    return null;
+}
+
+static void clients_open(u32 len_clients, u16 port) {
+    rlimit limit;
+    EXIT_IF(getrlimit(RLIMIT_NOFILE, &limit));
+    limit.rlim_cur = limit.rlim_max;
+    EXIT_IF(setrlimit(RLIMIT_NOFILE, &limit));
+    EXIT_IF(limit.rlim_cur < (len_clients + 64));
+    CLIENTS.len_clients = len_clients;
+    CLIENTS.clients = arena_alloc<Client>(&ARENAS.permanent, len_clients);
+    CLIENTS.epoll = epoll_create1(0);
+    EXIT_IF(CLIENTS.epoll < 0);
+    const sockaddr_in server = server_get_address(INADDR_LOOPBACK, port);
+    for (u32 i = 0; i < len_clients; ++i) {
+        Client* client = &CLIENTS.clients[i];
+        // NOTE: Lives as long as the level they play, and at `1000` clients
+        // is too much for the permanent arena.
+        client->states =
+            arena_alloc<ClientState>(&ARENAS.level, CLIENT_STATES);
+        memset(client->states, 0, sizeof(ClientState) * CLIENT_STATES);
+        client->sequence = 0;
+        client->ack = 0;
+        client->socket = server_get_socket();
+        if (connect(client->socket,
+                    reinterpret_cast<const sockaddr*>(&server),
+                    sizeof(server)))
+        {
+            EXIT_WITH(strerror(errno));
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        EXIT_IF(epoll_ctl(CLIENTS.epoll,
+                          EPOLL_CTL_ADD,
+                          client->socket,
+                          &event));
+    }
+    __atomic_store_n(&CLIENTS.running, true, __ATOMIC_RELEASE);
+    EXIT_IF(pthread_create(&CLIENTS.thread, null, client_run, null));
+}
+
+// NOTE: Compares the world each client last acknowledged with what the
+// server held at that tick, every player included, once the clients have had
+// `CLIENT_DRAIN` to catch up on whatever is still queued.
+static void clients_close() {
+    pacing_sleep_until(pacing_now() + CLIENT_DRAIN);
+    __atomic_store_n(&CLIENTS.running, false, __ATOMIC_RELEASE);
+    EXIT_IF(pthread_join(CLIENTS.thread, null));
+    for (u32 i = 0; i < CLIENTS.len_clients; ++i) {
+        const Client*      client = &CLIENTS.clients[i];
+        const ClientState* state = null;
+        for (u32 j = 0; j < CLIENT_STATES; ++j) {
+            if (client->states[j].complete &&
+                (client->states[j].tick == client->ack))
+            {
+                state = &client->states[j];
+            }
+        }
+        if ((!state) || (SERVER_HISTORY <= (SERVER.tick - state->tick))) {
+            ++CLIENTS.unverified;
+        } else if ((state->len_players !=
+                    SERVER.len_history[state->tick % SERVER_HISTORY]) ||
+                   memcmp(state->players,
+                          SERVER.history[state->tick % SERVER_HISTORY],
+                          sizeof(NetPlayer) * state->len_players))
+        {
+            ++CLIENTS.mismatched;
+        }
+        EXIT_IF(close(client->socket));
+    }
+    EXIT_IF(close(CLIENTS.epoll));
+}
+
+static void server_print(u64 ticks) {
+    const HistogramSummary simulate = histogram_get_summary(&SERVER.simulate);
+    const HistogramSummary snapshot = histogram_get_summary(&SERVER.snapshot);
+    printf("server   %5u players %8" PRIu64 " ticks %6" PRIu64
+           " late %8.3f ms tick p50 %8.3f ms p99 %8.3f ms snapshot p50 "
+           "%8.3f ms p99\n",
+           SERVER.len_clients,
+           ticks,
+           SERVER.late,
+           static_cast<f64>(simulate.p50) / NANOSECONDS_PER_MILLISECOND,
+           static_cast<f64>(simulate.p99) / NANOSECONDS_PER_MILLISECOND,
+           static_cast<f64>(snapshot.p50) / NANOSECONDS_PER_MILLISECOND,
+           static_cast<f64>(snapshot.p99) / NANOSECONDS_PER_MILLISECOND);
+    const f64 seconds = static_cast<f64>(ticks) / SERVER_RATE;
+    const f64 clients = static_cast<f64>(MAX(SERVER.len_clients, 1));
+    printf("per client %10.2f KiB/s %8.1f packets/s %8.1f bytes/snapshot "
+           "%6" PRIu64 " dropped %6" PRIu64 " refused\n",
+           (static_cast<f64>(SERVER.bytes_sent) / 1024.0) /
+               (seconds * clients),
+           static_cast<f64>(SERVER.packets_sent) / (seconds * clients),
+           static_cast<f64>(SERVER.bytes_sent) /
+               static_cast<f64>(MAX(SERVER.snapshots_sent, 1)),
+           SERVER.dropped,
+           SERVER.refused);
+}
+
+// NOTE: `bin/server [--clients <n>] [--seconds <n>] [--port <n>]
+// [--level <path>]`; fails if any scripted client disagrees with the server.
+i32 main(i32 argc, char** argv) {
+    arena_set(ARENA_PAGES_NORMAL);
+    u32 len_clients = 0;
+    u64 seconds = SERVER_SECONDS;
+    u16 port = NET_PORT;
+    {
+        const char* arg = get_arg(argc, argv, "--clients");
+        if (arg) {
+            len_clients = static_cast<u32>(strtoul(arg, null, 10));
+            EXIT_IF(NET_CAP_PLAYERS < len_clients);
+        }
+    }
+    {
+        const char* arg = get_arg(argc, argv, "--seconds");
+        if (arg) {
+            seconds = strtoul(arg, null, 10);
+            EXIT_IF(seconds == 0);
+        }
+    }
+    {
+        const char* arg = get_arg(argc, argv, "--port");
+        if (arg) {
+            port = static_cast<u16>(strtoul(arg, null, 10));
+        }
+    }
+    {
+        const char* path = get_arg(argc, argv, "--level");
+        level_open(path ? path : LEVEL_PATH, false);
+    }
+    level_set_grid(&SERVER.grid, &ARENAS.level);
+    server_open(port);
+    if (len_clients != 0) {
+        clients_open(len_clients, port);
+    }
+    const u64 ticks = seconds * SERVER_RATE;
+    server_run(ticks);
+    if (len_clients != 0) {
+        clients_close();
+    }
+    server_print(ticks);
+    if (len_clients != 0) {
+        printf("clients  %8" PRIu64 " snapshots %6" PRIu64
+               " undecodable %6" PRIu64 " refused %6" PRIu64
+               " unverified %6" PRIu64 " mismatched\n",
+               CLIENTS.snapshots,
+               CLIENTS.undecodable,
+               CLIENTS.refused,
+               CLIENTS.unverified,
+               CLIENTS.mismatched);
+    }
+    EXIT_IF(close(SERVER.socket));
+    level_close();
+    arena_delete();
+    if ((CLIENTS.mismatched != 0) || (CLIENTS.unverified != 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,8 @@
 #ifndef __SPATIAL_HASH_H__
 #define __SPATIAL_HASH_H__
 
-#include "math.hpp"
+#include "arena.hpp"
+#include "trace.hpp"
 
 #include <string.h>
 
@@ -29,49 +30,50 @@ struct Range {
     Index top;
 };
 
-struct List {
-    const Cube* cube;
-    List*       next;
-    List*       last;
-};
+#define GRID_CELLS (GRID_X * GRID_Y * GRID_Z)
 
-template <usize N, usize M>
+// NOTE: Cells are stored compressed: the cubes overlapping cell `i` are
+// `cubes[indices[j]]` for `offsets[i] <= j < offsets[i + 1]`. Nothing in here
+// is a pointer into the table, so a level file can carry it prebuilt and the
+// runtime can query the mapped copy directly. `intersects` always lives in
+// whichever arena the level was loaded into, as do `stamps`, which hold the
+// last query (`stamp`) that reported each cube; a copy queried on its own
+// needs its own of both (see `hash_set_intersects_buffer`).
 struct GridMemory {
-    List        grid[GRID_X][GRID_Y][GRID_Z];
-    Cube        bounds;
-    Vec3        span;
-    List        lists[N];
-    u8          len_lists;
-    const Cube* intersects[M];
-    u8          len_intersects;
+    Cube         bounds;
+    Vec3         span;
+    const Cube*  cubes;
+    const u32*   offsets;
+    const u32*   indices;
+    const Cube** intersects;
+    u32*         stamps;
+    u32          len_cubes;
+    u32          len_indices;
+    u32          len_intersects;
+    u32          stamp;
+    u64          count_queries;
+    u64          count_candidates;
 };
 
-template <usize N, usize M>
-static List* hash_alloc_list(GridMemory<N, M>* memory) {
-    EXIT_IF(N <= memory->len_lists);
-    List* list = &memory->lists[memory->len_lists++];
-    list->cube = null;
-    list->next = null;
-    list->last = null;
-    return list;
+static u32 hash_get_cell(u8 x, u8 y, u8 z) {
+    return static_cast<u32>((((x * GRID_Y) + y) * GRID_Z) + z);
 }
 
-template <usize N, usize M, const Cube* C>
-static void hash_set_bounds(GridMemory<N, M>* memory) {
-    memory->bounds = C[0];
-    for (u8 i = 0; i < M; ++i) {
+static void hash_set_bounds(GridMemory* memory) {
+    memory->bounds = memory->cubes[0];
+    for (u32 i = 0; i < memory->len_cubes; ++i) {
+        const Cube* cube = &memory->cubes[i];
         memory->bounds.bottom_left_front =
-            min(memory->bounds.bottom_left_front, C[i].bottom_left_front);
+            min(memory->bounds.bottom_left_front, cube->bottom_left_front);
         memory->bounds.top_right_back =
-            max(memory->bounds.top_right_back, C[i].top_right_back);
+            max(memory->bounds.top_right_back, cube->top_right_back);
     }
     memory->bounds.top_right_back += GRID_EPSILON;
     memory->span =
         memory->bounds.top_right_back - memory->bounds.bottom_left_front;
 }
 
-template <usize N, usize M>
-static Range hash_get_range(GridMemory<N, M>* memory, const Cube* cube) {
+static Range hash_get_range(GridMemory* memory, const Cube* cube) {
     const Vec3 bottom_left_front =
         ((cube->bottom_left_front - memory->bounds.bottom_left_front) /
          memory->span) *
@@ -94,47 +96,50 @@ static Range hash_get_range(GridMemory<N, M>* memory, const Cube* cube) {
     };
 }
 
-template <usize N, usize M>
-static void hash_push_grid(GridMemory<N, M>* memory,
-                           Index             grid_index,
-                           const Cube*       cube) {
-    List* grid = &memory->grid[grid_index.x][grid_index.y][grid_index.z];
-    if (!grid->cube) {
-        grid->cube = cube;
-        grid->next = null;
-        grid->last = null;
-        return;
+// NOTE: Counting sort into cells. Each cell keeps its cubes in the order
+// they appear in `cubes`, which is the order queries report them in. Both
+// passes read the same `ranges`: under `-ffast-math` two inlined copies of
+// `hash_get_range` can round a cube on a cell boundary differently.
+static void hash_set_grid(GridMemory*  memory,
+                          const Range* ranges,
+                          u32*         offsets,
+                          u32*         indices) {
+    memset(offsets, 0, sizeof(u32) * (GRID_CELLS + 1));
+    for (u32 i = 0; i < memory->len_cubes; ++i) {
+        const Range range = ranges[i];
+        for (u8 x = range.bottom.x; x <= range.top.x; ++x) {
+            for (u8 y = range.bottom.y; y <= range.top.y; ++y) {
+                for (u8 z = range.bottom.z; z <= range.top.z; ++z) {
+                    ++offsets[hash_get_cell(x, y, z) + 1];
+                }
+            }
+        }
     }
-    List* list = hash_alloc_list(memory);
-    list->cube = cube;
-    if (!grid->next) {
-        grid->next = list;
-        grid->last = list;
-        return;
+    for (u32 i = 0; i < GRID_CELLS; ++i) {
+        offsets[i + 1] += offsets[i];
     }
-    grid->last->next = list;
-    grid->last = list;
-}
-
-template <usize N, usize M, const Cube* C>
-static void hash_set_grid(GridMemory<N, M>* memory) {
-    memset(memory->grid, 0, sizeof(memory->grid));
-    memory->len_lists = 0;
-    for (u8 i = 0; i < M; ++i) {
-        const Range range = hash_get_range(memory, &C[i]);
+    EXIT_IF(offsets[GRID_CELLS] != memory->len_indices);
+    for (u32 i = 0; i < memory->len_cubes; ++i) {
+        const Range range = ranges[i];
         for (u8 x = range.bottom.x; x <= range.top.x; ++x) {
             for (u8 y = range.bottom.y; y <= range.top.y; ++y) {
                 for (u8 z = range.bottom.z; z <= range.top.z; ++z) {
-                    hash_push_grid(memory, {x, y, z}, &C[i]);
+                    indices[offsets[hash_get_cell(x, y, z)]++] = i;
                 }
             }
         }
     }
+    // NOTE: Filling advanced every cell's offset to where the next one
+    // starts; shift them back.
+    for (u32 i = GRID_CELLS; 0 < i; --i) {
+        offsets[i] = offsets[i - 1];
+    }
+    offsets[0] = 0;
+    memory->offsets = offsets;
+    memory->indices = indices;
 }
 
-template <usize N, usize M>
-static Cube hash_get_within_bounds(GridMemory<N, M>* memory,
-                                   const Cube*       cube) {
+static Cube hash_get_within_bounds(GridMemory* memory, const Cube* cube) {
     const Vec3 top_right_back = memory->bounds.top_right_back - GRID_EPSILON;
     return {
         clip(cube->bottom_left_front,
@@ -146,28 +151,104 @@ static Cube hash_get_within_bounds(GridMemory<N, M>* memory,
     };
 }
 
-template <usize N, usize M>
-static void hash_set_intersects(GridMemory<N, M>* memory, const Cube* cube) {
+// NOTE: A cube spanning several of the cells queried is only reported from
+// the first; `stamps` catch the rest in constant time, where scanning what
+// was already reported grew with the square of the candidates and stalled
+// queries over crowded cells. A query within one cell can't see a cube
+// twice and skips them. Reports come out in cell order either way.
+static void hash_set_intersects(GridMemory* memory, const Cube* cube) {
+    TRACE_SCOPE("hash_set_intersects");
     memory->len_intersects = 0;
     const Cube  bounds = hash_get_within_bounds(memory, cube);
     const Range range = hash_get_range(memory, &bounds);
-    for (u8 x = range.bottom.x; x <= range.top.x; ++x) {
-        for (u8 y = range.bottom.y; y <= range.top.y; ++y) {
-            for (u8 z = range.bottom.z; z <= range.top.z; ++z) {
-                List* list = &memory->grid[x][y][z];
-                while (list && (list->cube)) {
-                    for (u8 i = 0; i < memory->len_intersects; ++i) {
-                        if (list->cube == memory->intersects[i]) {
-                            goto next;
+    if ((range.bottom.x == range.top.x) && (range.bottom.y == range.top.y) &&
+        (range.bottom.z == range.top.z))
+    {
+        const u32 cell =
+            hash_get_cell(range.bottom.x, range.bottom.y, range.bottom.z);
+        for (u32 j = memory->offsets[cell]; j < memory->offsets[cell + 1];
+             ++j)
+        {
+            memory->intersects[memory->len_intersects++] =
+                &memory->cubes[memory->indices[j]];
+        }
+    } else {
+        if (++memory->stamp == 0) {
+            memset(memory->stamps, 0, sizeof(u32) * memory->len_cubes);
+            memory->stamp = 1;
+        }
+        for (u8 x = range.bottom.x; x <= range.top.x; ++x) {
+            for (u8 y = range.bottom.y; y <= range.top.y; ++y) {
+                for (u8 z = range.bottom.z; z <= range.top.z; ++z) {
+                    const u32 cell = hash_get_cell(x, y, z);
+                    for (u32 j = memory->offsets[cell];
+                         j < memory->offsets[cell + 1];
+                         ++j)
+                    {
+                        const u32 index = memory->indices[j];
+                        if (memory->stamps[index] == memory->stamp) {
+                            continue;
                         }
+                        memory->stamps[index] = memory->stamp;
+                        memory->intersects[memory->len_intersects++] =
+                            &memory->cubes[index];
                     }
-                    memory->intersects[memory->len_intersects++] = list->cube;
-                next:
-                    list = list->next;
                 }
             }
         }
     }
+    ++memory->count_queries;
+    memory->count_candidates += memory->len_intersects;
+}
+
+static void hash_set_intersects_buffer(GridMemory* memory, Arena* arena) {
+    memory->intersects = arena_alloc<const Cube*>(arena, memory->len_cubes);
+    memory->stamps = arena_alloc<u32>(arena, memory->len_cubes);
+    memset(memory->stamps, 0, sizeof(u32) * memory->len_cubes);
+    memory->len_intersects = 0;
+    memory->stamp = 0;
+}
+
+// NOTE: The most `hash_set` takes from its arena, alignment included, for
+// `len_cubes` cubes that between them touch `len_indices` cells.
+static usize hash_get_size(u32 len_cubes, u32 len_indices) {
+    return (sizeof(Range) * len_cubes) + (sizeof(u32) * (GRID_CELLS + 1)) +
+           (sizeof(u32) * len_indices) +
+           ((sizeof(const Cube*) + sizeof(u32)) * len_cubes) +
+           (alignof(const Cube*) * 5);
+}
+
+// NOTE: Builds the whole table at runtime; levels that carry a prebuilt one
+// skip this entirely. With no cubes at all (a streamed level with nothing
+// loaded nearby) the table covers a unit cube and every query comes back
+// empty.
+static void hash_set(GridMemory* memory,
+                     Arena*      arena,
+                     const Cube* cubes,
+                     u32         len_cubes) {
+    memory->cubes = cubes;
+    memory->len_cubes = len_cubes;
+    if (len_cubes == 0) {
+        memory->bounds = {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+        memory->span = memory->bounds.top_right_back;
+    } else {
+        hash_set_bounds(memory);
+    }
+    Range* ranges = arena_alloc<Range>(arena, len_cubes);
+    memory->len_indices = 0;
+    for (u32 i = 0; i < len_cubes; ++i) {
+        const Range range = hash_get_range(memory, &cubes[i]);
+        ranges[i] = range;
+        memory->len_indices += static_cast<u32>(
+            ((range.top.x - range.bottom.x) + 1) *
+            ((range.top.y - range.bottom.y) + 1) *
+            ((range.top.z - range.bottom.z) + 1));
+    }
+    hash_set_grid(memory,
+                  ranges,
+                  arena_alloc<u32>(arena, GRID_CELLS + 1),
+                  arena_alloc<u32>(arena, memory->len_indices));
+    hash_set_intersects_buffer(memory, arena);
 }
 
 #endif
@@ -0,0 +1,296 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include "level.hpp"
+#include "pacing.hpp"
+#include "scene.hpp"
+#include "trace.hpp"
+#include "triple.hpp"
+
+#include <pthread.h>
+
+// NOTE: `--stream` keeps only the chunks around the player resident, so
+// memory depends on `STREAM_DISTANCE` and the level's densest chunk rather
+// than on the size of the world. Three threads take part:
+//   - `stream_load` (its own thread) reads chunks into fixed slots as the
+//     player moves, evicting ones that have fallen out of range, and then
+//     rebuilds the broadphase over whatever is resident.
+//   - The render thread uploads changed slots into their fixed ranges of the
+//     instance buffer, at most `STREAM_UPLOAD` bytes per frame.
+//   - The simulation thread picks up each rebuilt broadphase between ticks.
+// Slot memory is only ever rewritten once the render thread has uploaded the
+// previous batch, so neither side waits on the other. Chunks are kept until
+// they are more than a chunk past `STREAM_DISTANCE`, so walking back and
+// forth over a boundary doesn't thrash.
+#define STREAM_DISTANCE 256.0f
+#define STREAM_PERIOD   (NANOSECONDS / 100lu)
+#define STREAM_UPLOAD   (1lu << 20)
+#define STREAM_EMPTY    0xFFFFFFFF
+
+// NOTE: One resident broadphase; `arena` holds its cubes and table.
+struct StreamGrid {
+    Arena      arena;
+    GridMemory grid;
+};
+
+struct Stream {
+    Triple<StreamGrid> grids;
+    Triple<Vec3>       center;
+    Instance*          instances;
+    Cube*              platforms;
+    u32*               chunks;
+    u32*               uploads;
+    GridMemory*        grid;
+    pthread_t          thread;
+    alignas(CACHE_LINE) u64 head;
+    alignas(CACHE_LINE) u64 tail;
+    i32                radius;
+    u32                len_slots;
+    u32                cap_slot;
+    u32                cap_uploads;
+    bool               running;
+    bool               enabled;
+};
+
+static Stream STREAM;
+
+static u32 stream_get_len() {
+    return STREAM.len_slots * STREAM.cap_slot;
+}
+
+static u32 stream_find_slot(u32 chunk) {
+    for (u32 i = 0; i < STREAM.len_slots; ++i) {
+        if (STREAM.chunks[i] == chunk) {
+            return i;
+        }
+    }
+    return STREAM_EMPTY;
+}
+
+static void stream_read(void* data, usize size, u64 offset) {
+    EXIT_IF(pread(LEVEL.file, data, size, static_cast<i64>(offset)) !=
+            static_cast<i64>(size));
+}
+
+// NOTE: Fills `slot` with `chunk`, or clears it for `STREAM_EMPTY`, and
+// queues it for upload. Unused instances are zeroed, which GL draws as
+// nothing.
+static void stream_set_slot(u32 slot, u32 chunk, u64* head) {
+    Instance* instances = &STREAM.instances[slot * STREAM.cap_slot];
+    Cube*     platforms = &STREAM.platforms[slot * STREAM.cap_slot];
+    u32       len = 0;
+    if (chunk != STREAM_EMPTY) {
+        const LevelChunk* level_chunk = &LEVEL.chunks[chunk];
+        EXIT_IF(STREAM.cap_slot < level_chunk->len);
+        EXIT_IF((LEVEL.len_platforms < level_chunk->first) ||
+                ((LEVEL.len_platforms - level_chunk->first) <
+                 level_chunk->len));
+        len = level_chunk->len;
+        stream_read(instances,
+                    sizeof(Instance) * len,
+                    LEVEL.header->offset_instances +
+                        (sizeof(Instance) * level_chunk->first));
+        stream_read(platforms,
+                    sizeof(Cube) * len,
+                    LEVEL.header->offset_platforms +
+                        (sizeof(Cube) * level_chunk->first));
+    }
+    memset(&instances[len], 0, sizeof(Instance) * (STREAM.cap_slot - len));
+    memset(&platforms[len], 0, sizeof(Cube) * (STREAM.cap_slot - len));
+    STREAM.chunks[slot] = chunk;
+    STREAM.uploads[(*head)++ % STREAM.cap_uploads] = slot;
+}
+
+// NOTE: Returns whether the resident set changed.
+static bool stream_set_chunks(Vec3 center) {
+    TRACE_SCOPE("stream_set_chunks");
+    const i32 x = level_get_chunk(center.x, LEVEL.header->chunk_size);
+    const i32 z = level_get_chunk(center.z, LEVEL.header->chunk_size);
+    u64       head = STREAM.head;
+    for (u32 i = 0; i < STREAM.len_slots; ++i) {
+        if (STREAM.chunks[i] == STREAM_EMPTY) {
+            continue;
+        }
+        const LevelChunk* chunk = &LEVEL.chunks[STREAM.chunks[i]];
+        if (((STREAM.radius + 1) < abs(chunk->x - x)) ||
+            ((STREAM.radius + 1) < abs(chunk->z - z)))
+        {
+            stream_set_slot(i, STREAM_EMPTY, &head);
+        }
+    }
+    for (i32 i = -STREAM.radius; i <= STREAM.radius; ++i) {
+        for (i32 j = -STREAM.radius; j <= STREAM.radius; ++j) {
+            const u32 chunk = level_find_chunk(x + i, z + j);
+            if ((chunk == LEVEL.len_chunks) ||
+                (stream_find_slot(chunk) != STREAM_EMPTY))
+            {
+                continue;
+            }
+            const u32 slot = stream_find_slot(STREAM_EMPTY);
+            EXIT_IF(slot == STREAM_EMPTY);
+            stream_set_slot(slot, chunk, &head);
+        }
+    }
+    if (head == STREAM.head) {
+        return false;
+    }
+    __atomic_store_n(&STREAM.head, head, __ATOMIC_RELEASE);
+    return true;
+}
+
+// NOTE: Rebuilt from scratch, but over the resident chunks only and never on
+// the simulation or render thread.
+static void stream_set_grid() {
+    TRACE_SCOPE("stream_set_grid");
+    StreamGrid* back = triple_get_back(&STREAM.grids);
+    arena_reset(&back->arena);
+    u32 len = 0;
+    for (u32 i = 0; i < STREAM.len_slots; ++i) {
+        if (STREAM.chunks[i] != STREAM_EMPTY) {
+            len += LEVEL.chunks[STREAM.chunks[i]].len;
+        }
+    }
+    Cube* cubes = arena_alloc<Cube>(&back->arena, len);
+    len = 0;
+    for (u32 i = 0; i < STREAM.len_slots; ++i) {
+        if (STREAM.chunks[i] == STREAM_EMPTY) {
+            continue;
+        }
+        const u32 len_chunk = LEVEL.chunks[STREAM.chunks[i]].len;
+        memcpy(&cubes[len],
+               &STREAM.platforms[i * STREAM.cap_slot],
+               sizeof(Cube) * len_chunk);
+        len += len_chunk;
+    }
+    hash_set(&back->grid, &back->arena, cubes, len);
+    triple_publish(&STREAM.grids);
+}
+
+// NOTE: Waits out any batch the render thread hasn't uploaded yet before
+// touching a slot.
+static void* stream_load(void*) {
+    TRACE_SET_THREAD("stream");
+    u64 next = pacing_now();
+    while (__atomic_load_n(&STREAM.running, __ATOMIC_ACQUIRE)) {
+        if ((__atomic_load_n(&STREAM.tail, __ATOMIC_ACQUIRE) == STREAM.head) &&
+            stream_set_chunks(*triple_get_front(&STREAM.center)))
+        {
+            stream_set_grid();
+        }
+        next += STREAM_PERIOD;
+        {
+            const u64 now = pacing_now();
+            if (next < now) {
+                next = now;
+            }
+        }
+        pacing_sleep_until(next);
+    }
+    return null;
+}
+
+// NOTE: Slots live in `ARENAS.level`; everything around `center` is loaded
+// before returning, so the first frame and the first tick see it.
+static void stream_open(Vec3 center) {
+    EXIT_IF(LEVEL.file < 0);
+    STREAM.enabled = true;
+    STREAM.radius = static_cast<i32>(
+        ceilf((STREAM_DISTANCE + LEVEL.header->chunk_extent) /
+              LEVEL.header->chunk_size));
+    {
+        const u32 side = static_cast<u32>(((STREAM.radius + 1) * 2) + 1);
+        STREAM.len_slots = side * side;
+    }
+    STREAM.cap_slot = LEVEL.header->len_chunk_max;
+    STREAM.cap_uploads = STREAM.len_slots * 2;
+    STREAM.instances =
+        arena_alloc<Instance>(&ARENAS.level, stream_get_len());
+    STREAM.platforms = arena_alloc<Cube>(&ARENAS.level, stream_get_len());
+    STREAM.chunks = arena_alloc<u32>(&ARENAS.level, STREAM.len_slots);
+    STREAM.uploads = arena_alloc<u32>(&ARENAS.level, STREAM.cap_uploads);
+    for (u32 i = 0; i < STREAM.len_slots; ++i) {
+        STREAM.chunks[i] = STREAM_EMPTY;
+    }
+    STREAM.head = 0;
+    STREAM.tail = 0;
+    triple_set(&STREAM.center, &center);
+    {
+        const StreamGrid grid = {};
+        triple_set(&STREAM.grids, &grid);
+        // NOTE: Enough for every resident cube to land in every cell; see
+        // `hash_get_size`.
+        const usize size =
+            (stream_get_len() *
+             (sizeof(Cube) + sizeof(Range) + sizeof(const Cube*) +
+              sizeof(u32) + (sizeof(u32) * GRID_CELLS))) +
+            (sizeof(u32) * (GRID_CELLS + 1)) + ARENA_PAGE;
+        const usize cap =
+            (size + (ARENA_HUGE_PAGE - 1)) & ~(ARENA_HUGE_PAGE - 1);
+        for (u8 i = 0; i < 3; ++i) {
+            arena_open(&STREAM.grids.slots[i].value.arena,
+                       "stream",
+                       cap,
+                       ARENAS.level.pages);
+        }
+    }
+    stream_set_chunks(center);
+    stream_set_grid();
+    // NOTE: `scene_set_buffers` uploads every slot as it is.
+    STREAM.tail = STREAM.head;
+    STREAM.grid = &triple_get_front(&STREAM.grids)->grid;
+}
+
+static void stream_start() {
+    __atomic_store_n(&STREAM.running, true, __ATOMIC_RELEASE);
+    EXIT_IF(pthread_create(&STREAM.thread, null, stream_load, null));
+}
+
+// NOTE: Render thread, once per frame.
+static void stream_set_center(Vec3 center) {
+    *triple_get_back(&STREAM.center) = center;
+    triple_publish(&STREAM.center);
+}
+
+// NOTE: Render thread, once per frame. Always makes some progress, however
+// large a slot is.
+static void stream_upload() {
+    TRACE_SCOPE("stream_upload");
+    const u64 head = __atomic_load_n(&STREAM.head, __ATOMIC_ACQUIRE);
+    u64       tail = STREAM.tail;
+    for (usize size = 0; (tail < head) && (size < STREAM_UPLOAD); ++tail) {
+        const u32 first =
+            STREAM.uploads[tail % STREAM.cap_uploads] * STREAM.cap_slot;
+        scene_set_instances(first,
+                            &STREAM.instances[first],
+                            &STREAM.platforms[first],
+                            STREAM.cap_slot);
+        size += (sizeof(Instance) + sizeof(Cube)) * STREAM.cap_slot;
+    }
+    __atomic_store_n(&STREAM.tail, tail, __ATOMIC_RELEASE);
+}
+
+// NOTE: Simulation thread, once per tick. Query counts carry over from one
+// broadphase to the next.
+static GridMemory* stream_get_grid() {
+    const u64 count_queries = STREAM.grid->count_queries;
+    const u64 count_candidates = STREAM.grid->count_candidates;
+    STREAM.grid = &triple_get_front(&STREAM.grids)->grid;
+    STREAM.grid->count_queries = count_queries;
+    STREAM.grid->count_candidates = count_candidates;
+    return STREAM.grid;
+}
+
+// NOTE: Also closes a stream that was never started; `bin/test` walks one
+// on its own thread with `stream_set_chunks` and `stream_set_grid`.
+static void stream_close() {
+    if (STREAM.running) {
+        __atomic_store_n(&STREAM.running, false, __ATOMIC_RELEASE);
+        EXIT_IF(pthread_join(STREAM.thread, null));
+    }
+    for (u8 i = 0; i < 3; ++i) {
+        arena_print(&STREAM.grids.slots[i].value.arena);
+        arena_close(&STREAM.grids.slots[i].value.arena);
+    }
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include "arena.hpp"
+#include "trace.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE: Broadphase for things that move every tick (players, bots), kept
+// apart from the grid in `spatial_hash.hpp`, which is built once per level
+// for platforms that never move. Each tracked axis keeps both endpoints of
+// every agent in one sorted array. Agents barely move between ticks, so
+// re-sorting is an insertion sort that does little more than one pass, and
+// each swap it does make is one pair of agents starting or stopping
+// overlapping on that axis. Those swaps alone keep `pairs` current, so
+// agents nowhere near each other are never tested.
+//
+// Only `x` and `z` are tracked. Agents all stand within a few units of the
+// same height, so a sorted `y` would put most of them within a jump of each
+// other and every jump would swap past thousands; `y` is checked instead
+// when the pairs are reported. Overlap is inclusive: touching counts.
+//
+// Swaps per agent grow with the square root of the crowd, since an agent
+// crosses more others' intervals per tick the wider the crowd is. Against
+// rebuilding an agent-sized uniform grid every tick (`grid_pairs/N` in
+// `bin/bench`), this wins at a hundred agents and loses from about a
+// thousand on.
+#define SWEEP_AXES 2
+
+// NOTE: An endpoint's `id` is its agent's index shifted up by one, with the
+// low bit set for the agent's maximum.
+#define SWEEP_MAX 1
+
+// NOTE: `across_min` and `across_max` are the agent's interval on the other
+// tracked axis, carried along so most swaps never have to look at `cubes`.
+struct SweepEndpoint {
+    f32 value;
+    u32 id;
+    f32 across_min;
+    f32 across_max;
+};
+
+// NOTE: `a < b`.
+struct SweepPair {
+    u32 a;
+    u32 b;
+};
+
+// NOTE: `pairs` holds every pair overlapping on `x` and `z`, in no
+// particular order; `slots` is an open-addressed table over it, holding
+// `1 +` each pair's index, or `0` when empty. `counts` is how many of
+// `pairs` each agent is in. `overlaps` is the part of `pairs` that also
+// overlapped on `y` as of the last `sweep_update`.
+struct Sweep {
+    const Cube*    cubes;
+    SweepEndpoint* endpoints[SWEEP_AXES];
+    SweepPair*     pairs;
+    SweepPair*     overlaps;
+    u32*           slots;
+    u32*           counts;
+    u32            len_agents;
+    u32            len_pairs;
+    u32            len_overlaps;
+    u32            cap_pairs;
+    u32            mask;
+    u64            count_swaps;
+};
+
+static bool sweep_overlaps_xz(const Cube* a, const Cube* b) {
+    return (a->bottom_left_front.x <= b->top_right_back.x) &&
+           (b->bottom_left_front.x <= a->top_right_back.x) &&
+           (a->bottom_left_front.z <= b->top_right_back.z) &&
+           (b->bottom_left_front.z <= a->top_right_back.z);
+}
+
+static bool sweep_overlaps_y(const Cube* a, const Cube* b) {
+    return (a->bottom_left_front.y <= b->top_right_back.y) &&
+           (b->bottom_left_front.y <= a->top_right_back.y);
+}
+
+static SweepEndpoint sweep_get_endpoint(const Cube* cubes, u8 axis, u32 id) {
+    const Cube* cube = &cubes[id >> 1];
+    const Vec3  corner =
+        (id & SWEEP_MAX) ? cube->top_right_back : cube->bottom_left_front;
+    if (axis == 0) {
+        return {corner.x,
+                id,
+                cube->bottom_left_front.z,
+                cube->top_right_back.z};
+    }
+    return {corner.z, id, cube->bottom_left_front.x, cube->top_right_back.x};
+}
+
+// NOTE: Minimums sort before maximums of equal value, which is what makes
+// touching count as overlapping.
+static bool sweep_precedes(SweepEndpoint l, SweepEndpoint r) {
+    return (l.value < r.value) ||
+           ((!(r.value < l.value)) &&
+            ((l.id & SWEEP_MAX) < (r.id & SWEEP_MAX)));
+}
+
+static i32 sweep_compare(const void* l, const void* r) {
+    const SweepEndpoint a = *reinterpret_cast<const SweepEndpoint*>(l);
+    const SweepEndpoint b = *reinterpret_cast<const SweepEndpoint*>(r);
+    if (sweep_precedes(a, b)) {
+        return -1;
+    }
+    if (sweep_precedes(b, a)) {
+        return 1;
+    }
+    return (a.id < b.id) ? -1 : (b.id < a.id) ? 1 : 0;
+}
+
+static u32 sweep_hash(u32 a, u32 b) {
+    return static_cast<u32>(
+        ((((static_cast<u64>(a) << 32) | b) * 0x9E3779B97F4A7C15lu) >> 32));
+}
+
+// NOTE: Linear probing; returns the slot holding `(a, b)`, or the empty one
+// it would go in.
+static u32 sweep_find_slot(const Sweep* sweep, u32 a, u32 b) {
+    u32 slot = sweep_hash(a, b) & sweep->mask;
+    while (sweep->slots[slot]) {
+        const SweepPair pair = sweep->pairs[sweep->slots[slot] - 1];
+        if ((pair.a == a) && (pair.b == b)) {
+            break;
+        }
+        slot = (slot + 1) & sweep->mask;
+    }
+    return slot;
+}
+
+static void sweep_insert(Sweep* sweep, u32 a, u32 b) {
+    const u32 slot = sweep_find_slot(sweep, a, b);
+    if (sweep->slots[slot]) {
+        return;
+    }
+    EXIT_IF(sweep->len_pairs == sweep->cap_pairs);
+    sweep->pairs[sweep->len_pairs++] = {a, b};
+    sweep->slots[slot] = sweep->len_pairs;
+    ++sweep->counts[a];
+    ++sweep->counts[b];
+}
+
+// NOTE: Shifts the rest of the probe run back over the hole rather than
+// leaving a tombstone, then moves the last pair into the gap in `pairs`.
+// Most agents are in no pair at all, and then the table isn't touched.
+static void sweep_remove(Sweep* sweep, u32 a, u32 b) {
+    if (!sweep->counts[a] || !sweep->counts[b]) {
+        return;
+    }
+    u32 hole = sweep_find_slot(sweep, a, b);
+    if (!sweep->slots[hole]) {
+        return;
+    }
+    --sweep->counts[a];
+    --sweep->counts[b];
+    const u32 index = sweep->slots[hole] - 1;
+    for (u32 slot = (hole + 1) & sweep->mask; sweep->slots[slot];
+         slot = (slot + 1) & sweep->mask)
+    {
+        const SweepPair pair = sweep->pairs[sweep->slots[slot] - 1];
+        const u32       home = sweep_hash(pair.a, pair.b) & sweep->mask;
+        if (((hole - home) & sweep->mask) < ((slot - home) & sweep->mask)) {
+            sweep->slots[hole] = sweep->slots[slot];
+            hole = slot;
+        }
+    }
+    sweep->slots[hole] = 0;
+    const u32 last = --sweep->len_pairs;
+    if (index != last) {
+        const SweepPair pair = sweep->pairs[last];
+        sweep->slots[sweep_find_slot(sweep, pair.a, pair.b)] = index + 1;
+        sweep->pairs[index] = pair;
+    }
+}
+
+// NOTE: Refreshes the axis from `cubes`, then insertion sorts it. A minimum
+// moving down past another agent's maximum may be the start of an overlap;
+// a maximum moving down past another agent's minimum is the end of one.
+static void sweep_set_axis(Sweep* sweep, u8 axis) {
+    SweepEndpoint* endpoints = sweep->endpoints[axis];
+    const Cube*    cubes = sweep->cubes;
+    const u32      len_endpoints = sweep->len_agents * 2;
+    for (u32 i = 0; i < len_endpoints; ++i) {
+        endpoints[i] = sweep_get_endpoint(cubes, axis, endpoints[i].id);
+    }
+    for (u32 i = 1; i < len_endpoints; ++i) {
+        const SweepEndpoint endpoint = endpoints[i];
+        u32                 j = i;
+        for (; (0 < j) && sweep_precedes(endpoint, endpoints[j - 1]); --j) {
+            const SweepEndpoint other = endpoints[j - 1];
+            endpoints[j] = other;
+            ++sweep->count_swaps;
+            if ((endpoint.id & SWEEP_MAX) == (other.id & SWEEP_MAX)) {
+                continue;
+            }
+            const u32 a = MIN(endpoint.id >> 1, other.id >> 1);
+            const u32 b = MAX(endpoint.id >> 1, other.id >> 1);
+            if (endpoint.id & SWEEP_MAX) {
+                sweep_remove(sweep, a, b);
+            } else if ((endpoint.across_min <= other.across_max) &&
+                       (other.across_min <= endpoint.across_max) &&
+                       sweep_overlaps_xz(&cubes[a], &cubes[b]))
+            {
+                sweep_insert(sweep, a, b);
+            }
+        }
+        endpoints[j] = endpoint;
+    }
+}
+
+static void sweep_set_overlaps(Sweep* sweep) {
+    sweep->len_overlaps = 0;
+    for (u32 i = 0; i < sweep->len_pairs; ++i) {
+        const SweepPair pair = sweep->pairs[i];
+        if (sweep_overlaps_y(&sweep->cubes[pair.a], &sweep->cubes[pair.b])) {
+            sweep->overlaps[sweep->len_overlaps++] = pair;
+        }
+    }
+}
+
+// NOTE: Call once per tick, after moving `cubes` in place.
+static void sweep_update(Sweep* sweep) {
+    TRACE_SCOPE("sweep_update");
+    for (u8 i = 0; i < SWEEP_AXES; ++i) {
+        sweep_set_axis(sweep, i);
+    }
+    sweep_set_overlaps(sweep);
+}
+
+// NOTE: Sorts both axes from scratch and finds the first set of pairs with
+// one sweep along `x`, testing each agent against those whose `x` interval
+// it starts inside. `cubes` is read again on every `sweep_update`, so it
+// must outlive `sweep`; everything else, scratch included, comes from
+// `arena`. `cap_pairs` bounds how many pairs may overlap on `x` and `z` at
+// once.
+static void sweep_set(Sweep*      sweep,
+                      Arena*      arena,
+                      const Cube* cubes,
+                      u32         len_agents,
+                      u32         cap_pairs) {
+    EXIT_IF((len_agents == 0) || ((0xFFFFFFFFu >> 1) < len_agents));
+    sweep->cubes = cubes;
+    sweep->len_agents = len_agents;
+    sweep->len_pairs = 0;
+    sweep->len_overlaps = 0;
+    sweep->cap_pairs = cap_pairs;
+    sweep->count_swaps = 0;
+    u32 len_slots = 1;
+    while (len_slots < (cap_pairs * 2)) {
+        len_slots <<= 1;
+    }
+    sweep->mask = len_slots - 1;
+    sweep->slots = arena_alloc<u32>(arena, len_slots);
+    memset(sweep->slots, 0, sizeof(u32) * len_slots);
+    sweep->counts = arena_alloc<u32>(arena, len_agents);
+    memset(sweep->counts, 0, sizeof(u32) * len_agents);
+    sweep->pairs = arena_alloc<SweepPair>(arena, cap_pairs);
+    sweep->overlaps = arena_alloc<SweepPair>(arena, cap_pairs);
+    const u32 len_endpoints = len_agents * 2;
+    for (u8 i = 0; i < SWEEP_AXES; ++i) {
+        sweep->endpoints[i] = arena_alloc<SweepEndpoint>(arena, len_endpoints);
+        for (u32 j = 0; j < len_endpoints; ++j) {
+            sweep->endpoints[i][j] = sweep_get_endpoint(cubes, i, j);
+        }
+        qsort(sweep->endpoints[i],
+              len_endpoints,
+              sizeof(SweepEndpoint),
+              sweep_compare);
+    }
+    u32* active = arena_alloc<u32>(arena, len_agents);
+    u32* positions = arena_alloc<u32>(arena, len_agents);
+    u32  len_active = 0;
+    for (u32 i = 0; i < len_endpoints; ++i) {
+        const u32 id = sweep->endpoints[0][i].id;
+        const u32 agent = id >> 1;
+        if (id & SWEEP_MAX) {
+            const u32 last = active[--len_active];
+            active[positions[agent]] = last;
+            positions[last] = positions[agent];
+            continue;
+        }
+        for (u32 j = 0; j < len_active; ++j) {
+            if (sweep_overlaps_xz(&cubes[agent], &cubes[active[j]])) {
+                sweep_insert(sweep,
+                             MIN(agent, active[j]),
+                             MAX(agent, active[j]));
+            }
+        }
+        positions[agent] = len_active;
+        active[len_active++] = agent;
+    }
+    sweep_set_overlaps(sweep);
+}
+
+#endif
@@ -0,0 +1,582 @@
+#include "input.hpp"
+#include "level.hpp"
+#include "stream.hpp"
+#include "sweep.hpp"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE: Checks that the fast paths agree with the slow ones they replace;
+// `scripts/build.sh` runs it after every build and stops at the first
+// mismatch. Each check runs `TEST_TRIALS` times on random inputs.
+#define TEST_TRIALS (1u << 12)
+
+// NOTE: Relative to the larger magnitude once that exceeds `1`. The SIMD
+// paths reassociate sums, and `-ffast-math` lets both sides contract and
+// reciprocate differently, so bit-exact results aren't expected.
+#define TEST_EPSILON 1e-4f
+
+// NOTE: Agents wander a box `TEST_AGENT_SPACING` units on a side per agent,
+// dense enough that pairs start and stop overlapping every tick.
+#define TEST_AGENTS        1000
+#define TEST_AGENT_SPACING 3.0f
+#define TEST_AGENT_PAIRS   8
+#define TEST_AGENT_TICKS   64
+
+// NOTE: Floyd-Warshall is cubic, so larger levels skip the path check.
+// `-ffast-math` assumes there are no infinities, so unreachable is a finite
+// distance large enough that adding two of them still can't overflow.
+#define TEST_CAP_REACH   2048
+#define TEST_UNREACHABLE 1e30f
+
+// NOTE: The walk crosses the level's bounds in `x` in `TEST_STREAM_STEPS`
+// steps, turning in `z` every `TEST_STREAM_WEAVE` of them, and makes
+// `TEST_STREAM_QUERIES` queries of at most `TEST_STREAM_SIZE` a side per
+// step. Queries against the whole level dominate, so there are few of them.
+#define TEST_STREAM_STEPS   512
+#define TEST_STREAM_WEAVE   32
+#define TEST_STREAM_QUERIES 16
+#define TEST_STREAM_SIZE    8.0f
+
+struct Test {
+    u32 seed;
+    u64 len_checks;
+};
+
+static Test TEST;
+
+static u32 test_get_random() {
+    TEST.seed ^= TEST.seed << 13;
+    TEST.seed ^= TEST.seed >> 17;
+    TEST.seed ^= TEST.seed << 5;
+    return TEST.seed;
+}
+
+static f32 test_get_random_f32(f32 l, f32 r) {
+    return l + ((r - l) * (static_cast<f32>(test_get_random() >> 8) /
+                           static_cast<f32>(1 << 24)));
+}
+
+static Vec3 test_get_random_vec3() {
+    return {
+        test_get_random_f32(-10.0f, 10.0f),
+        test_get_random_f32(-10.0f, 10.0f),
+        test_get_random_f32(-10.0f, 10.0f),
+    };
+}
+
+static Mat4 test_get_random_mat4() {
+    Mat4 m;
+    for (u8 i = 0; i < 4; ++i) {
+        for (u8 j = 0; j < 4; ++j) {
+            m.cell[i][j] = test_get_random_f32(-10.0f, 10.0f);
+        }
+    }
+    return m;
+}
+
+static bool test_is_near(f32 l, f32 r) {
+    ++TEST.len_checks;
+    return fabsf(l - r) <= (TEST_EPSILON * MAX(1.0f, MAX(fabsf(l), fabsf(r))));
+}
+
+static bool test_is_near(Vec3 l, Vec3 r) {
+    return test_is_near(l.x, r.x) && test_is_near(l.y, r.y) &&
+           test_is_near(l.z, r.z);
+}
+
+static bool test_is_near(Mat4 l, Mat4 r) {
+    for (u8 i = 0; i < 4; ++i) {
+        for (u8 j = 0; j < 4; ++j) {
+            if (!test_is_near(l.cell[i][j], r.cell[i][j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// NOTE: Column-major, like the SIMD version: `l * r`.
+static Mat4 test_multiply(Mat4 l, Mat4 r) {
+    Mat4 m = {};
+    for (u8 i = 0; i < 4; ++i) {
+        for (u8 j = 0; j < 4; ++j) {
+            for (u8 k = 0; k < 4; ++k) {
+                m.cell[i][j] += l.cell[k][j] * r.cell[i][k];
+            }
+        }
+    }
+    return m;
+}
+
+static Vec4 test_transform(Mat4 m, Vec4 x) {
+    Vec4 y;
+    for (u8 j = 0; j < 4; ++j) {
+        y.cell[j] = 0.0f;
+        for (u8 k = 0; k < 4; ++k) {
+            y.cell[j] += m.cell[k][j] * x.cell[k];
+        }
+    }
+    return y;
+}
+
+// NOTE: The scalar `look_at` the SIMD one replaced.
+static Mat4 test_look_at(Vec3 eye, Vec3 target, Vec3 up) {
+    const Vec3 f = norm(target - eye);
+    const Vec3 s = norm(cross(f, up));
+    const Vec3 u = cross(s, f);
+    Mat4       m = {};
+    m.cell[0][0] = s.x;
+    m.cell[0][1] = u.x;
+    m.cell[0][2] = -f.x;
+    m.cell[1][0] = s.y;
+    m.cell[1][1] = u.y;
+    m.cell[1][2] = -f.y;
+    m.cell[2][0] = s.z;
+    m.cell[2][1] = u.z;
+    m.cell[2][2] = -f.z;
+    m.cell[3][0] = -dot(s, eye);
+    m.cell[3][1] = -dot(u, eye);
+    m.cell[3][2] = dot(f, eye);
+    m.cell[3][3] = 1.0f;
+    return m;
+}
+
+static void test_math_vectors() {
+    for (u32 i = 0; i < TEST_TRIALS; ++i) {
+        const Vec3 l = test_get_random_vec3();
+        const Vec3 r = test_get_random_vec3();
+        {
+            Vec4 x;
+            x.simd = simd_dot(simd_get(l, 0.0f), simd_get(r, 0.0f));
+            for (u8 j = 0; j < 4; ++j) {
+                EXIT_IF(!test_is_near(x.cell[j], dot(l, r)));
+            }
+        }
+        {
+            Vec4 x;
+            x.simd = simd_cross(simd_get(l, 0.0f), simd_get(r, 0.0f));
+            EXIT_IF(!test_is_near(simd_get_vec3(x.simd), cross(l, r)));
+            EXIT_IF(!test_is_near(x.cell[3], 0.0f));
+        }
+        if (0.01f < len(l)) {
+            const Vec3 x = simd_get_vec3(simd_norm(simd_get(l, 0.0f)));
+            EXIT_IF(!test_is_near(x, norm(l)));
+        }
+    }
+}
+
+static void test_math_matrices() {
+    for (u32 i = 0; i < TEST_TRIALS; ++i) {
+        const Mat4 l = test_get_random_mat4();
+        const Mat4 r = test_get_random_mat4();
+        EXIT_IF(!test_is_near(l * r, test_multiply(l, r)));
+    }
+    // NOTE: An odd count, so the AVX path's one-point tail runs too.
+    Vec4 points[7];
+    Vec4 out[7];
+    for (u32 i = 0; i < TEST_TRIALS; ++i) {
+        const Mat4 m = test_get_random_mat4();
+        for (u32 j = 0; j < 7; ++j) {
+            points[j].simd = simd_get(test_get_random_vec3(),
+                                      test_get_random_f32(-1.0f, 1.0f));
+        }
+        transform(&m, points, out, 7);
+        for (u32 j = 0; j < 7; ++j) {
+            const Vec4 x = test_transform(m, points[j]);
+            for (u8 k = 0; k < 4; ++k) {
+                EXIT_IF(!test_is_near(out[j].cell[k], x.cell[k]));
+            }
+        }
+    }
+}
+
+static void test_math_camera() {
+    const Mat4 identity = diag(1.0f);
+    for (u32 i = 0; i < TEST_TRIALS; ++i) {
+        const Vec3 eye = test_get_random_vec3();
+        const Vec3 target = test_get_random_vec3();
+        if (len(target - eye) < 0.01f) {
+            continue;
+        }
+        const Vec3 up = {0.0f, 1.0f, 0.0f};
+        if (len(cross(norm(target - eye), up)) < 0.01f) {
+            continue;
+        }
+        const Mat4 view = look_at(eye, target, up);
+        EXIT_IF(!test_is_near(view, test_look_at(eye, target, up)));
+        const Mat4 m = test_multiply(
+            translate(test_get_random_vec3()),
+            test_multiply(view,
+                          scale({test_get_random_f32(0.5f, 2.0f),
+                                 test_get_random_f32(0.5f, 2.0f),
+                                 test_get_random_f32(0.5f, 2.0f)})));
+        EXIT_IF(!test_is_near(test_multiply(m, affine_inverse(m)), identity));
+    }
+}
+
+static i32 test_compare_pairs(const void* l, const void* r) {
+    const SweepPair a = *reinterpret_cast<const SweepPair*>(l);
+    const SweepPair b = *reinterpret_cast<const SweepPair*>(r);
+    if (a.a != b.a) {
+        return (a.a < b.a) ? -1 : 1;
+    }
+    return (a.b < b.b) ? -1 : (b.b < a.b) ? 1 : 0;
+}
+
+// NOTE: `sweep_update` must report exactly the pairs that testing every
+// pair would, tick after tick, as agents bounce around a box.
+static void test_sweep() {
+    const f32 side =
+        sqrtf(static_cast<f32>(TEST_AGENTS)) * TEST_AGENT_SPACING;
+    const Vec3 size = {PLAYER_WIDTH, PLAYER_HEIGHT, PLAYER_DEPTH};
+    const Vec3 bounds = Vec3{side, JUMP_HEIGHT, side} + size;
+    const u32  cap_pairs = TEST_AGENTS * TEST_AGENT_PAIRS;
+    Cube*      cubes = arena_alloc<Cube>(&ARENAS.level, TEST_AGENTS);
+    Vec3*      speeds = arena_alloc<Vec3>(&ARENAS.level, TEST_AGENTS);
+    SweepPair* expected = arena_alloc<SweepPair>(&ARENAS.level, cap_pairs);
+    for (u32 i = 0; i < TEST_AGENTS; ++i) {
+        const Vec3 bottom_left_front = {
+            test_get_random_f32(0.0f, side),
+            test_get_random_f32(0.0f, JUMP_HEIGHT),
+            test_get_random_f32(0.0f, side),
+        };
+        cubes[i] = {bottom_left_front, bottom_left_front + size};
+        speeds[i] = {
+            test_get_random_f32(-SPEED_MAX, SPEED_MAX),
+            test_get_random_f32(-JUMP, JUMP),
+            test_get_random_f32(-SPEED_MAX, SPEED_MAX),
+        };
+    }
+    Sweep sweep;
+    sweep_set(&sweep, &ARENAS.level, cubes, TEST_AGENTS, cap_pairs);
+    for (u32 i = 0; i < TEST_AGENT_TICKS; ++i) {
+        if (i != 0) {
+            for (u32 j = 0; j < TEST_AGENTS; ++j) {
+                cubes[j].bottom_left_front += speeds[j];
+                cubes[j].top_right_back += speeds[j];
+                const Vec3 low = cubes[j].bottom_left_front;
+                const Vec3 high = cubes[j].top_right_back;
+                if ((low.x < 0.0f) || (bounds.x < high.x)) {
+                    speeds[j].x = -speeds[j].x;
+                }
+                if ((low.y < 0.0f) || (bounds.y < high.y)) {
+                    speeds[j].y = -speeds[j].y;
+                }
+                if ((low.z < 0.0f) || (bounds.z < high.z)) {
+                    speeds[j].z = -speeds[j].z;
+                }
+            }
+            sweep_update(&sweep);
+        }
+        u32 len_expected = 0;
+        for (u32 a = 0; a < TEST_AGENTS; ++a) {
+            for (u32 b = a + 1; b < TEST_AGENTS; ++b) {
+                if (sweep_overlaps_xz(&cubes[a], &cubes[b]) &&
+                    sweep_overlaps_y(&cubes[a], &cubes[b]))
+                {
+                    EXIT_IF(len_expected == cap_pairs);
+                    expected[len_expected++] = {a, b};
+                }
+            }
+        }
+        EXIT_IF(len_expected == 0);
+        EXIT_IF(sweep.len_overlaps != len_expected);
+        qsort(sweep.overlaps,
+              len_expected,
+              sizeof(SweepPair),
+              test_compare_pairs);
+        EXIT_IF(memcmp(sweep.overlaps,
+                       expected,
+                       sizeof(SweepPair) * len_expected));
+        TEST.len_checks += len_expected;
+    }
+}
+
+// NOTE: A key event dropped on a full queue must go out again with the next
+// key set, or the simulation would never see the key.
+static void test_input() {
+    InputQueue* queue = &INPUT_QUEUE;
+    Input       input = {};
+    input_reset(queue);
+    for (u64 i = 0; i < INPUT_CAP_EVENTS; ++i) {
+        input_push_look(queue, i, {});
+    }
+    input_push_keys(queue, INPUT_CAP_EVENTS, INPUT_KEY_W);
+    EXIT_IF(queue->dropped != 1);
+    input_pop(queue, INPUT_CAP_EVENTS, &input);
+    EXIT_IF(input.keys);
+    input_push_keys(queue, INPUT_CAP_EVENTS + 1, INPUT_KEY_W);
+    input_pop(queue, INPUT_CAP_EVENTS + 1, &input);
+    EXIT_IF(input.keys != INPUT_KEY_W);
+    input_push_keys(queue, INPUT_CAP_EVENTS + 2, INPUT_KEY_W);
+    EXIT_IF(queue->head != queue->tail);
+    TEST.len_checks += 4;
+}
+
+// NOTE: The key callback's path: a press dropped on a full queue must still
+// arrive with the next key that changes, and a dropped release with the next
+// frame's push of `held`.
+static void test_input_key() {
+    InputQueue* queue = &INPUT_QUEUE;
+    Input       input = {};
+    u64         time = 0;
+    input_reset(queue);
+    for (u64 i = 0; i < INPUT_CAP_EVENTS; ++i) {
+        input_push_look(queue, time++, {});
+    }
+    input_push_key(queue, time, INPUT_KEY_W, true);
+    EXIT_IF(queue->dropped != 1);
+    input_pop(queue, time++, &input);
+    EXIT_IF(input.keys);
+    input_push_key(queue, time, INPUT_KEY_A, true);
+    input_pop(queue, time++, &input);
+    EXIT_IF(input.keys != (INPUT_KEY_W | INPUT_KEY_A));
+    for (u64 i = 0; i < INPUT_CAP_EVENTS; ++i) {
+        input_push_look(queue, time++, {});
+    }
+    input_push_key(queue, time, INPUT_KEY_A, false);
+    EXIT_IF(queue->dropped != 2);
+    input_pop(queue, time++, &input);
+    EXIT_IF(input.keys != (INPUT_KEY_W | INPUT_KEY_A));
+    input_push_keys(queue, time, queue->held);
+    input_pop(queue, time++, &input);
+    EXIT_IF(input.keys != INPUT_KEY_W);
+    TEST.len_checks += 6;
+}
+
+// NOTE: `LEVEL_SCALED` picks the shader variant, so it must say what the
+// instances actually are.
+static void test_flags() {
+    EXIT_IF(((LEVEL.header->flags & LEVEL_SCALED) != 0) !=
+            level_is_scaled(LEVEL.instances, LEVEL.len_platforms));
+    ++TEST.len_checks;
+}
+
+// NOTE: Whatever grid the level carries must be exactly the one the runtime
+// would have built from its platforms.
+static void test_grid() {
+    EXIT_IF(!LEVEL.grid);
+    GridMemory baked;
+    GridMemory built;
+    level_set_grid(&baked, &ARENAS.level);
+    hash_set(&built, &ARENAS.level, LEVEL.platforms, LEVEL.len_platforms);
+    EXIT_IF(memcmp(&baked.bounds, &built.bounds, sizeof(Cube)));
+    EXIT_IF(memcmp(&baked.span, &built.span, sizeof(Vec3)));
+    EXIT_IF(baked.len_indices != built.len_indices);
+    EXIT_IF(memcmp(baked.offsets,
+                   built.offsets,
+                   sizeof(u32) * (GRID_CELLS + 1)));
+    EXIT_IF(memcmp(baked.indices,
+                   built.indices,
+                   sizeof(u32) * baked.len_indices));
+    TEST.len_checks += GRID_CELLS + baked.len_indices;
+}
+
+// NOTE: The graph the level carries must be the one `reach_get` builds from
+// its platforms now. Costs come out of simulated jumps, which other
+// optimization levels may round differently, so only they are compared
+// with a tolerance.
+static void test_reach_mapped(const GridMemory* grid) {
+    EXIT_IF(!LEVEL.reach.offsets);
+    const Reach mapped = LEVEL.reach;
+    const Reach built = reach_get(grid, &ARENAS.level);
+    EXIT_IF(mapped.len_platforms != built.len_platforms);
+    EXIT_IF(mapped.len_edges != built.len_edges);
+    EXIT_IF(memcmp(mapped.offsets,
+                   built.offsets,
+                   sizeof(u32) * (mapped.len_platforms + 1)));
+    for (u32 i = 0; i < mapped.len_edges; ++i) {
+        EXIT_IF(mapped.edges[i].platform != built.edges[i].platform);
+        EXIT_IF(!test_is_near(mapped.edges[i].cost, built.edges[i].cost));
+    }
+}
+
+// NOTE: `reach_find_paths` must find, for every pair of platforms, a path
+// exactly when one exists, along real edges, as cheap as Floyd-Warshall's
+// all-pairs distances say the cheapest is.
+static void test_reach_paths() {
+    const Reach reach = LEVEL.reach;
+    const u32   n = reach.len_platforms;
+    if (TEST_CAP_REACH < n) {
+        return;
+    }
+    f32* distances = arena_alloc<f32>(&ARENAS.level, n * n);
+    for (u32 i = 0; i < (n * n); ++i) {
+        distances[i] = TEST_UNREACHABLE;
+    }
+    for (u32 i = 0; i < n; ++i) {
+        distances[(i * n) + i] = 0.0f;
+        for (u32 j = reach.offsets[i]; j < reach.offsets[i + 1]; ++j) {
+            f32* distance = &distances[(i * n) + reach.edges[j].platform];
+            *distance = MIN(*distance, reach.edges[j].cost);
+        }
+    }
+    for (u32 k = 0; k < n; ++k) {
+        for (u32 i = 0; i < n; ++i) {
+            for (u32 j = 0; j < n; ++j) {
+                const f32 distance =
+                    distances[(i * n) + k] + distances[(k * n) + j];
+                distances[(i * n) + j] =
+                    MIN(distances[(i * n) + j], distance);
+            }
+        }
+    }
+    ReachQuery* queries = arena_alloc<ReachQuery>(&ARENAS.level, n * n);
+    ReachPath*  paths = arena_alloc<ReachPath>(&ARENAS.level, n * n);
+    for (u32 i = 0; i < n; ++i) {
+        for (u32 j = 0; j < n; ++j) {
+            queries[(i * n) + j] = {i, j};
+        }
+    }
+    reach_find_paths(&reach,
+                     LEVEL.platforms,
+                     queries,
+                     paths,
+                     n * n,
+                     &ARENAS.level);
+    u32 len_reachable = 0;
+    for (u32 i = 0; i < (n * n); ++i) {
+        const ReachPath* path = &paths[i];
+        if (TEST_UNREACHABLE <= distances[i]) {
+            EXIT_IF(path->len != 0);
+            continue;
+        }
+        ++len_reachable;
+        EXIT_IF(path->len == 0);
+        EXIT_IF(path->platforms[0] != queries[i].from);
+        EXIT_IF(path->platforms[path->len - 1] != queries[i].to);
+        f32 cost = 0.0f;
+        for (u32 j = 1; j < path->len; ++j) {
+            const u32 from = path->platforms[j - 1];
+            f32       edge = TEST_UNREACHABLE;
+            for (u32 k = reach.offsets[from]; k < reach.offsets[from + 1];
+                 ++k)
+            {
+                if (reach.edges[k].platform == path->platforms[j]) {
+                    edge = MIN(edge, reach.edges[k].cost);
+                }
+            }
+            EXIT_IF(TEST_UNREACHABLE <= edge);
+            cost += edge;
+        }
+        EXIT_IF(!test_is_near(cost, path->cost));
+        EXIT_IF(!test_is_near(distances[i], path->cost));
+    }
+    // NOTE: A graph where nothing connects would pass everything above.
+    EXIT_IF(len_reachable <= n);
+}
+
+// NOTE: Walks the stream across the level the way `stream_load` would, one
+// step per period, and checks that every query within `STREAM_DISTANCE` of
+// the player finds exactly the platforms a grid over the whole level does.
+// Streamed cubes are copies, so they are matched by value.
+static void test_stream(const char* path) {
+    level_open(path, true);
+    GridMemory full;
+    level_set_grid(&full, &ARENAS.level);
+    const Cube bounds = full.bounds;
+    const f32  step = (bounds.top_right_back.x - bounds.bottom_left_front.x) /
+                     TEST_STREAM_STEPS;
+    const f32  reach = STREAM_DISTANCE - TEST_STREAM_SIZE;
+    Vec3       center = {
+        bounds.bottom_left_front.x,
+        0.0f,
+        (bounds.bottom_left_front.z + bounds.top_right_back.z) / 2.0f,
+    };
+    stream_open(center);
+    u64 len_hits = 0;
+    for (u32 i = 0; i < TEST_STREAM_STEPS; ++i) {
+        center.x += step;
+        center.z += ((i / TEST_STREAM_WEAVE) & 1) ? -step : step;
+        if (stream_set_chunks(center)) {
+            stream_set_grid();
+        }
+        STREAM.tail = STREAM.head;
+        GridMemory* grid = stream_get_grid();
+        for (u32 j = 0; j < TEST_STREAM_QUERIES; ++j) {
+            const Vec3 bottom_left_front = {
+                center.x + test_get_random_f32(-reach, reach),
+                test_get_random_f32(bounds.bottom_left_front.y,
+                                    bounds.top_right_back.y),
+                center.z + test_get_random_f32(-reach, reach),
+            };
+            const Vec3 size = {
+                test_get_random_f32(0.0f, TEST_STREAM_SIZE),
+                test_get_random_f32(0.0f, TEST_STREAM_SIZE),
+                test_get_random_f32(0.0f, TEST_STREAM_SIZE),
+            };
+            const Cube query = {bottom_left_front, bottom_left_front + size};
+            hash_set_intersects(grid, &query);
+            u32 len_streamed = 0;
+            for (u32 k = 0; k < grid->len_intersects; ++k) {
+                const Cube* cube = grid->intersects[k];
+                len_streamed += sweep_overlaps_xz(cube, &query) &&
+                                sweep_overlaps_y(cube, &query);
+            }
+            hash_set_intersects(&full, &query);
+            u32 len_full = 0;
+            for (u32 k = 0; k < full.len_intersects; ++k) {
+                const Cube* cube = full.intersects[k];
+                if (!(sweep_overlaps_xz(cube, &query) &&
+                      sweep_overlaps_y(cube, &query)))
+                {
+                    continue;
+                }
+                ++len_full;
+                u32 l = 0;
+                for (; l < grid->len_intersects; ++l) {
+                    if (!memcmp(grid->intersects[l], cube, sizeof(Cube))) {
+                        break;
+                    }
+                }
+                EXIT_IF(l == grid->len_intersects);
+            }
+            EXIT_IF(len_streamed != len_full);
+            len_hits += len_full;
+        }
+    }
+    // NOTE: A walk that never leaves the first chunk behind, or never finds
+    // anything, would pass everything above.
+    EXIT_IF(stream_find_slot(0) != STREAM_EMPTY);
+    EXIT_IF(len_hits == 0);
+    TEST.len_checks += len_hits;
+    stream_close();
+    level_close();
+}
+
+// NOTE: `bin/test [--level <path>] [--stream <path>]`; exits at the first
+// failed check. `--stream` wants a level spanning many chunks.
+i32 main(i32 argc, char** argv) {
+    TEST.seed = 0x9E3779B9u;
+    arena_set(ARENA_PAGES_NORMAL);
+    test_math_vectors();
+    test_math_matrices();
+    test_math_camera();
+    test_sweep();
+    test_input();
+    test_input_key();
+    {
+        const char* path = get_arg(argc, argv, "--level");
+        level_open(path ? path : LEVEL_PATH, false);
+    }
+    test_flags();
+    test_grid();
+    {
+        GridMemory grid;
+        level_set_grid(&grid, &ARENAS.level);
+        test_reach_mapped(&grid);
+    }
+    test_reach_paths();
+    level_close();
+    {
+        const char* path = get_arg(argc, argv, "--stream");
+        if (path) {
+            test_stream(path);
+        }
+    }
+    arena_delete();
+    printf("test     %8" PRIu64 " checks\n", TEST.len_checks);
+    return EXIT_SUCCESS;
+}
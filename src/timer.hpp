@@ -0,0 +1,128 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include "init.hpp"
+
+#include <inttypes.h>
+
+#define TIMER_CLEAR    0
+#define TIMER_DRAW     1
+#define TIMER_HIZ      2
+#define TIMER_CULL     3
+#define TIMER_DRAW_NEW 4
+#define TIMER_BLIT     5
+#define TIMER_PASSES   6
+
+// NOTE: One set of queries per frame in flight. Finished frames are read
+// oldest first, and only once `GL_QUERY_RESULT_AVAILABLE` says so, so the CPU
+// never waits on the GPU. A frame still unread when its set is about to be
+// reused is given up: it is counted in `skipped` and logged as a row with
+// empty fields, since the frames that run late are exactly the expensive
+// ones and dropping them silently would flatter the CSV.
+#define TIMER_FRAMES 4
+
+#define TIMER_SMOOTHING 0.1f
+
+struct Timer {
+    u32   queries[TIMER_FRAMES][TIMER_PASSES];
+    u64   elapsed[TIMER_PASSES];
+    f32   pass_time[TIMER_PASSES];
+    f32   gpu_time;
+    u64   frame;
+    u64   read;
+    u64   skipped;
+    FILE* log;
+};
+
+static Timer TIMER;
+
+static void timer_set_queries(FILE* log) {
+    glGenQueries(TIMER_FRAMES * TIMER_PASSES, &TIMER.queries[0][0]);
+    TIMER.frame = 0;
+    TIMER.read = 0;
+    TIMER.skipped = 0;
+    TIMER.log = log;
+    if (TIMER.log) {
+        fprintf(TIMER.log, "frame,clear,draw,hiz,cull,draw_new,blit,total\n");
+    }
+    CHECK_GL_ERROR();
+}
+
+static void timer_begin(u8 pass) {
+    glBeginQuery(GL_TIME_ELAPSED,
+                 TIMER.queries[TIMER.frame % TIMER_FRAMES][pass]);
+}
+
+static void timer_end() {
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+static bool timer_get_available(const u32* queries) {
+    for (u8 i = 0; i < TIMER_PASSES; ++i) {
+        i32 available;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void timer_set_results(const u32* queries) {
+    u64 total = 0;
+    for (u8 i = 0; i < TIMER_PASSES; ++i) {
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &TIMER.elapsed[i]);
+        total += TIMER.elapsed[i];
+        TIMER.pass_time[i] +=
+            ((static_cast<f32>(TIMER.elapsed[i]) / 1000.0f) -
+             TIMER.pass_time[i]) *
+            TIMER_SMOOTHING;
+    }
+    TIMER.gpu_time +=
+        ((static_cast<f32>(total) / 1000.0f) - TIMER.gpu_time) *
+        TIMER_SMOOTHING;
+    if (TIMER.log) {
+        fprintf(TIMER.log,
+                "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                TIMER.read,
+                TIMER.elapsed[TIMER_CLEAR],
+                TIMER.elapsed[TIMER_DRAW],
+                TIMER.elapsed[TIMER_HIZ],
+                TIMER.elapsed[TIMER_CULL],
+                TIMER.elapsed[TIMER_DRAW_NEW],
+                TIMER.elapsed[TIMER_BLIT],
+                total);
+    }
+}
+
+static void timer_end_frame() {
+    ++TIMER.frame;
+    for (; TIMER.read < TIMER.frame; ++TIMER.read) {
+        const u32* queries = TIMER.queries[TIMER.read % TIMER_FRAMES];
+        if (!timer_get_available(queries)) {
+            break;
+        }
+        timer_set_results(queries);
+    }
+    // NOTE: The next frame reuses the oldest set in the ring.
+    if ((TIMER.frame - TIMER.read) == TIMER_FRAMES) {
+        if (TIMER.log) {
+            fprintf(TIMER.log, "%" PRIu64 ",,,,,,,\n", TIMER.read);
+        }
+        ++TIMER.skipped;
+        ++TIMER.read;
+    }
+}
+
+static void timer_delete_queries() {
+    glDeleteQueries(TIMER_FRAMES * TIMER_PASSES, &TIMER.queries[0][0]);
+    if (TIMER.log) {
+        fclose(TIMER.log);
+        printf("timer    %8" PRIu64 " frames %8" PRIu64 " skipped\n",
+               TIMER.read - TIMER.skipped,
+               TIMER.skipped);
+    }
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+// NOTE: Scoped CPU tracer. Build with `-DTRACING` to enable it; otherwise
+// every `TRACE_*` macro expands to nothing and none of this is compiled.
+#ifdef TRACING
+
+#include "math.hpp"
+#include "pacing.hpp"
+
+#include <inttypes.h>
+#include <signal.h>
+#include <string.h>
+#include <x86intrin.h>
+
+// NOTE: Each thread writes only to its own ring, so recording a scope is two
+// `rdtsc` reads, three stores, and a release store of the count.
+#define TRACE_THREADS  4
+#define TRACE_CAPACITY (1lu << 14)
+#define TRACE_MASK     (TRACE_CAPACITY - 1lu)
+
+// NOTE: A frame taking this many periods is dumped automatically, at most
+// once every `TRACE_COOLDOWN` frames.
+#define TRACE_LONG_FRAME 2lu
+#define TRACE_COOLDOWN   120lu
+
+#define TRACE_CAP_PATH 256
+
+struct TraceEvent {
+    const char* name;
+    u64         begin;
+    u64         end;
+};
+
+struct TraceRing {
+    TraceEvent  events[TRACE_CAPACITY];
+    const char* name;
+    u64         count;
+};
+
+struct Trace {
+    TraceRing   rings[TRACE_THREADS];
+    TraceEvent  snapshot[TRACE_CAPACITY];
+    const char* prefix;
+    u64         tsc_start;
+    u64         time_start;
+    u64         dump_frame;
+    u8          len_rings;
+};
+
+static Trace TRACE;
+
+static thread_local TraceRing* TRACE_RING = null;
+
+static volatile sig_atomic_t TRACE_REQUESTED = 0;
+
+static void trace_push(const char* name, u64 begin, u64 end) {
+    TraceRing* ring = TRACE_RING;
+    if (!ring) {
+        return;
+    }
+    const u64   count = ring->count;
+    TraceEvent* event = &ring->events[count & TRACE_MASK];
+    event->name = name;
+    event->begin = begin;
+    event->end = end;
+    __atomic_store_n(&ring->count, count + 1, __ATOMIC_RELEASE);
+}
+
+struct TraceScope {
+    const char* name;
+    u64         begin;
+
+    explicit TraceScope(const char* label) : name(label), begin(__rdtsc()) {
+    }
+
+    ~TraceScope() {
+        trace_push(name, begin, __rdtsc());
+    }
+};
+
+static void trace_signal_callback(i32) {
+    TRACE_REQUESTED = 1;
+}
+
+// NOTE: `kill -USR1 <pid>` requests a dump at the end of the next frame.
+static void trace_set(const char* prefix) {
+    TRACE.prefix = prefix;
+    TRACE.tsc_start = __rdtsc();
+    TRACE.time_start = pacing_now();
+    TRACE.dump_frame = 0;
+    struct sigaction action = {};
+    action.sa_handler = trace_signal_callback;
+    EXIT_IF(sigaction(SIGUSR1, &action, null));
+}
+
+static void trace_set_thread(const char* name) {
+    const u8 index = __atomic_fetch_add(&TRACE.len_rings, 1, __ATOMIC_ACQ_REL);
+    EXIT_IF(TRACE_THREADS <= index);
+    TRACE_RING = &TRACE.rings[index];
+    __atomic_store_n(&TRACE_RING->name, name, __ATOMIC_RELEASE);
+}
+
+// NOTE: Other threads keep writing while their ring is copied. Anything the
+// writer may have lapped during the copy is dropped instead of emitted torn.
+static void trace_write_ring(FILE*      file,
+                             TraceRing* ring,
+                             u8         tid,
+                             f64        scale) {
+    const u64 count = __atomic_load_n(&ring->count, __ATOMIC_ACQUIRE);
+    memcpy(TRACE.snapshot, ring->events, sizeof(TRACE.snapshot));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    const u64 lapped = __atomic_load_n(&ring->count, __ATOMIC_RELAXED);
+    u64       first = count < TRACE_CAPACITY ? 0 : count - TRACE_CAPACITY;
+    if (TRACE_CAPACITY <= lapped) {
+        first = MAX(first, (lapped - TRACE_CAPACITY) + 1);
+    }
+    for (u64 i = first; i < count; ++i) {
+        const TraceEvent* event = &TRACE.snapshot[i & TRACE_MASK];
+        fprintf(file,
+                ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%hhu,"
+                "\"ts\":%.3f,\"dur\":%.3f}",
+                event->name,
+                tid,
+                static_cast<f64>(event->begin - TRACE.tsc_start) * scale,
+                static_cast<f64>(event->end - event->begin) * scale);
+    }
+}
+
+// NOTE: Chrome trace event format; opens in `chrome://tracing` or Perfetto.
+static void trace_dump(u64 frame) {
+    if (!TRACE.prefix) {
+        return;
+    }
+    char path[TRACE_CAP_PATH];
+    snprintf(path,
+             sizeof(path),
+             "%s-%" PRIu64 ".json",
+             TRACE.prefix,
+             frame);
+    FILE* file = fopen(path, "w");
+    EXIT_IF(!file);
+    // NOTE: Calibrated against `CLOCK_MONOTONIC` over the whole run so far;
+    // scales ticks straight to microseconds.
+    const f64 scale =
+        (static_cast<f64>(pacing_now() - TRACE.time_start) /
+         static_cast<f64>(__rdtsc() - TRACE.tsc_start)) /
+        1000.0;
+    fprintf(file,
+            "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+            "\"args\":{\"name\":\"jmpr\"}}");
+    const u8 len_rings = __atomic_load_n(&TRACE.len_rings, __ATOMIC_ACQUIRE);
+    for (u8 i = 0; i < MIN(len_rings, TRACE_THREADS); ++i) {
+        TraceRing*  ring = &TRACE.rings[i];
+        const char* name = __atomic_load_n(&ring->name, __ATOMIC_ACQUIRE);
+        if (!name) {
+            continue;
+        }
+        fprintf(file,
+                ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                "\"tid\":%hhu,\"args\":{\"name\":\"%s\"}}",
+                i,
+                name);
+        trace_write_ring(file, ring, i, scale);
+    }
+    fprintf(file, "\n]}\n");
+    EXIT_IF(fclose(file));
+}
+
+static void trace_end_frame(u64 frame, u64 begin, u64 end) {
+    const bool long_frame = (TRACE_LONG_FRAME * PACING.period) < (end - begin);
+    if (TRACE_REQUESTED ||
+        (long_frame && ((TRACE.dump_frame + TRACE_COOLDOWN) < frame)))
+    {
+        TRACE_REQUESTED = 0;
+        TRACE.dump_frame = frame;
+        trace_dump(frame);
+    }
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+
+#define TRACE_SET(prefix)            trace_set(prefix)
+#define TRACE_SET_THREAD(name)       trace_set_thread(name)
+#define TRACE_END_FRAME(frame, a, b) trace_end_frame(frame, a, b)
+
+#define TRACE_SCOPE(name) \
+    const TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_SET(prefix)
+#define TRACE_SET_THREAD(name)
+#define TRACE_END_FRAME(frame, a, b)
+
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __TRIPLE_H__
+#define __TRIPLE_H__
+
+#include "prelude.hpp"
+
+// NOTE: Lock-free triple buffer for exactly one writer and one reader. The
+// writer fills `back` and swaps it into `middle`; the reader swaps `middle`
+// into `front` only when it has been marked dirty, so neither side ever
+// waits on the other and the reader always sees the latest complete value.
+#define TRIPLE_INDEX 3
+#define TRIPLE_DIRTY 4
+
+#define CACHE_LINE 64
+
+template <typename T>
+struct alignas(CACHE_LINE) TripleSlot {
+    T value;
+};
+
+template <typename T>
+struct Triple {
+    TripleSlot<T>         slots[3];
+    alignas(CACHE_LINE) u8 front;
+    alignas(CACHE_LINE) u8 back;
+    alignas(CACHE_LINE) u8 middle;
+};
+
+template <typename T>
+static void triple_set(Triple<T>* triple, const T* value) {
+    for (u8 i = 0; i < 3; ++i) {
+        triple->slots[i].value = *value;
+    }
+    triple->front = 0;
+    triple->back = 1;
+    __atomic_store_n(&triple->middle, 2, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+static T* triple_get_back(Triple<T>* triple) {
+    return &triple->slots[triple->back].value;
+}
+
+template <typename T>
+static void triple_publish(Triple<T>* triple) {
+    triple->back = static_cast<u8>(
+        __atomic_exchange_n(&triple->middle,
+                            static_cast<u8>(triple->back | TRIPLE_DIRTY),
+                            __ATOMIC_ACQ_REL) &
+        TRIPLE_INDEX);
+}
+
+// NOTE: The reader owns `front` until its next call, so it may scribble on
+// it, e.g. scratch space that travels with the value.
+template <typename T>
+static T* triple_get_front(Triple<T>* triple) {
+    if (__atomic_load_n(&triple->middle, __ATOMIC_ACQUIRE) & TRIPLE_DIRTY) {
+        triple->front = static_cast<u8>(
+            __atomic_exchange_n(&triple->middle,
+                                triple->front,
+                                __ATOMIC_ACQ_REL) &
+            TRIPLE_INDEX);
+    }
+    return &triple->slots[triple->front].value;
+}
+
+#endif
@@ -3,25 +3,57 @@
 precision mediump float;
 
 layout(location = 0) in vec3 IN_VERTEX;
+#ifndef UNLIT
 layout(location = 1) in vec3 IN_NORMAL;
+#endif
 layout(location = 2) in mat4 IN_TRANSLATE;
 layout(location = 6) in vec3 IN_COLOR;
+layout(location = 7) in float IN_VISIBLE_PREV;
+layout(location = 8) in float IN_VISIBLE;
 
-// NOTE: `TIME` unused!
-uniform float TIME;
-uniform vec3  POSITION;
-uniform mat4  PROJECTION;
-uniform mat4  VIEW;
+// NOTE: Laid out to match `SceneFrame`; shared with `cull_vert.glsl`.
+layout(std140) uniform FRAME {
+    mat4 PROJECTION;
+    mat4 VIEW;
+    vec3 POSITION;
+};
 
+uniform int PHASE;
+
+#ifndef UNLIT
 out vec3 VERT_OUT_VERTEX;
 out vec3 VERT_OUT_NORMAL;
 out vec3 VERT_OUT_POSITION;
+#endif
 out vec3 VERT_OUT_COLOR;
 
 void main() {
-    VERT_OUT_VERTEX = vec3(IN_TRANSLATE * vec4(IN_VERTEX, 1.0));
+    // NOTE: Phase `0` draws what was visible last frame, phase `1` draws only
+    // what the `Hi-Z` test found to be newly visible.
+    bool draw = PHASE == 0 ? 0.0 < IN_VISIBLE_PREV
+                           : (0.0 < IN_VISIBLE) && (IN_VISIBLE_PREV <= 0.0);
+    if (!draw) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+#ifdef SCALED
+    vec3 scale =
+        vec3(IN_TRANSLATE[0][0], IN_TRANSLATE[1][1], IN_TRANSLATE[2][2]);
+    vec3 vertex = (IN_VERTEX * scale) + IN_TRANSLATE[3].xyz;
+#else
+    vec3 vertex = vec3(IN_TRANSLATE * vec4(IN_VERTEX, 1.0));
+#endif
+#ifndef UNLIT
+    VERT_OUT_VERTEX = vertex;
+#ifdef SCALED
+    // NOTE: With no rotation or shear the normal matrix is just the
+    // reciprocal of the scale.
+    VERT_OUT_NORMAL = IN_NORMAL / scale;
+#else
     VERT_OUT_NORMAL = mat3(transpose(inverse(IN_TRANSLATE))) * IN_NORMAL;
+#endif
     VERT_OUT_POSITION = POSITION;
+#endif
     VERT_OUT_COLOR = IN_COLOR;
-    gl_Position = PROJECTION * VIEW * IN_TRANSLATE * vec4(IN_VERTEX, 1.0);
+    gl_Position = PROJECTION * VIEW * vec4(vertex, 1.0);
 }